@@ -19,6 +19,10 @@ start = time.time()
 PLAYERS = 20000
 GAMES = 10000000
 STRATEGY = "trueskill"
+# Stores player histories quantized (~3x less memory, decoded back to doubles on export)
+COMPACT_HISTORY = False
+# Which player histories are recorded ("all", "none", "sample", "percentile")
+TRACKING = dict(tracking="all")
 """
 PLAYERS = 20000
 GAMES = 100000000
@@ -108,13 +112,15 @@ def plot_data(data, prediction_differences, match_accuracy, PLAYERS, GAMES,
     ## PLAYER HISTORY
     def plot_mmr_history(DATAVALUES=6):
         plt.figure().clear()
+        # Only players with recorded histories (see TRACKING)
+        tracked = [i for i in data if i["mmr_history"].size > 0]
         unique_opponents = [
-            len(np.unique(i["opponent_history"])) for i in data
+            len(np.unique(i["opponent_history"])) for i in tracked
         ]
         extremes = [
-            p for p in sorted(data, key=lambda x: x["skill"], reverse=True)
+            p for p in sorted(tracked, key=lambda x: x["skill"], reverse=True)
         ]
-        players = data[:DATAVALUES - 2] + [extremes[0], extremes[-1]]
+        players = tracked[:DATAVALUES - 2] + [extremes[0], extremes[-1]]
         fig, ax = plt.subplots(5, 1)
 
         for i in range(3):
@@ -337,7 +343,7 @@ def plot_data(data, prediction_differences, match_accuracy, PLAYERS, GAMES,
         ax2 = ax1.twinx()
         ndata = [i for i in sorted(data, key=lambda x: x["mmr"])]
         nmmrs = [i["mmr"] for i in ndata]
-        histories = [i["opponent_history"].size for i in ndata]
+        histories = [i["games_played"] for i in ndata]
         ax2.scatter(nmmrs, histories, s=2)
         ax2.set_ylabel(
             f"Game count per player ({min(histories)}-{max(histories)})",
@@ -349,7 +355,7 @@ def plot_data(data, prediction_differences, match_accuracy, PLAYERS, GAMES,
 
         ## Games played
         plt.figure().clear()
-        games_played = [i["opponent_history"].size for i in data]
+        games_played = [i["games_played"] for i in data]
         sns.histplot(games_played, element='poly')
         plt.xlabel("Games played")
         plt.ylabel("Player count")
@@ -368,7 +374,7 @@ def plot_data(data, prediction_differences, match_accuracy, PLAYERS, GAMES,
 if __name__ == "__main__":
     psimulation.set_my_python_function(trueskill_rate.rate_1v1)
     data, prediction_differences, match_accuracy, good_match_fraction = psimulation.run_simulation(
-        PLAYERS, GAMES, STRATEGY)
+        PLAYERS, GAMES, STRATEGY, compact_history=COMPACT_HISTORY, **TRACKING)
     process = psutil.Process(os.getpid())
     print(
         f"Peak memory usage during simulation: {process.memory_info().peak_wset/(1024*1024):.0f} MB"
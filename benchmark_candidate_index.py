@@ -0,0 +1,42 @@
+"""
+Compares opponent search through the candidate index with random tries.
+
+The index pays off when good matches are rare: many regions and a tight latency limit, so a random opponent
+is rarely within reach. When most random opponents are within reach, random tries are cheaper.
+
+    python benchmark_candidate_index.py
+    python benchmark_candidate_index.py --players 2000000 --games 1000000 --regions 6 --max-latency 60
+
+"""
+import argparse
+import time
+
+import psimulation
+
+
+def run(args, candidate_index):
+    """ Runs one simulation and returns seconds and mean prediction difference """
+    start = time.time()
+    result = psimulation.run_simulation_aggregated(args.players, args.games, args.strategy, regions=args.regions,
+                                                   max_latency=args.max_latency, candidate_index=candidate_index,
+                                                   seed=args.seed, good_match_sample=500)
+    return time.time() - start, float(result["prediction_difference_sum"]) / args.games
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--players", type=int, default=2000000)
+    parser.add_argument("--games", type=int, default=1000000)
+    parser.add_argument("--strategy", default="elo")
+    parser.add_argument("--regions", type=int, default=12)
+    parser.add_argument("--max-latency", type=float, default=25)
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    results = {name: run(args, index) for name, index in (("random tries", False), ("candidate index", True))}
+    for name, (seconds, prediction) in results.items():
+        print(f"{name:16} {seconds:6.2f} s  mean prediction difference {prediction:.4f}")
+
+
+if __name__ == "__main__":
+    main()
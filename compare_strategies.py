@@ -22,52 +22,47 @@ legend = [[], []]
 start = time.time()
 
 
-def smooth(array: np.ndarray, bins: int) -> np.ndarray:
-    """ Smooths out a vector by averaging inside bins"""
-    L = int(array.size / bins)  # bin length
-    new = np.array([])
-    for i in range(bins):
-        new = np.append(new, np.average(array[L * i:L * (i + 1)]))
-    return new
-
-
 skills = None
 ts_data = dict()
 
 for idx, strategy in enumerate(strategy_types):
-    data, prediction_differences, match_accuracy, good_match_fraction = psimulation.run_simulation(
-        PLAYERS, GAMES, strategy)
-
-    # SIGMA
+    # Binned statistics are computed by the extension. Raw data is needed only for trueskill plots.
     if strategy == 'trueskill':
+        data, prediction_differences, match_accuracy, good_match_fraction, aggregates = psimulation.run_simulation(
+            PLAYERS, GAMES, strategy, bins=BINS)
         ts_data['data'] = data
         ts_data['prediction_differences'] = prediction_differences
         ts_data['match_accuracy'] = match_accuracy
+    else:
+        aggregates = psimulation.run_simulation_aggregated(PLAYERS,
+                                                           GAMES,
+                                                           strategy,
+                                                           bins=BINS)
 
     # MMR - SKILL
-    data = np.array([i for i in sorted(data, key=lambda x: x["skill"])])
     if skills is None:
-        skills = np.array([i["skill"] for i in data])
-    mmrs = np.array([i["mmr"] for i in data])
-    ax[2].plot(skills, mmrs)
+        skills = aggregates["skill"]
+    ax[2].plot(aggregates["skill"], aggregates["mmr"])
 
     # Other plots
     x = np.linspace(1, BINS, BINS)
-    legend[1].append(f"{strategy} ({np.sum(match_accuracy)/100000:.2f})")
+    legend[1].append(
+        f"{strategy} ({aggregates['match_accuracy_sum']/100000:.2f})")
     legend[0].append(
-        f"{strategy} ({np.sum(prediction_differences)/100000:.2f})")
-
-    prediction_differences = smooth(prediction_differences, BINS)
-    match_accuracy = smooth(match_accuracy, BINS)
+        f"{strategy} ({aggregates['prediction_difference_sum']/100000:.2f})")
 
     # Plot & save legend
-    p = ax[1].plot(x * GAMES / BINS, match_accuracy)
+    p = ax[1].plot(x * GAMES / BINS, aggregates["match_accuracy_mean"])
     color = p[0].get_color()
-    ax[0].plot(x * GAMES / BINS, prediction_differences, color=color)
+    ax[0].plot(x * GAMES / BINS,
+               aggregates["prediction_difference_mean"],
+               color=color)
 
     # Good match fraction
-    good_match_fraction = smooth(good_match_fraction, 100)
-    ax[3].plot(np.arange(100), good_match_fraction, label=strategy, alpha=0.5)
+    ax[3].plot(np.linspace(0, 100, BINS),
+               aggregates["good_match_fraction_mean"],
+               label=strategy,
+               alpha=0.5)
 
 ax[3].set_title(f"The fraction of good matches")
 ax[3].set_xlabel("Games")
@@ -1,41 +1,93 @@
 #pragma once
 
 #include "mutils.h"
+#include "history.h"
 
 #include <vector>
 #include <memory>
 
+// Storage type for player ratings and skill. Building with PSIM_FLOAT_RATINGS stores them as float32
+// for very large populations (computations are still done in doubles).
+#ifdef PSIM_FLOAT_RATINGS
+typedef float rating_t;
+#else
+typedef double rating_t;
+#endif
+
 //
 // PLAYER CLASS
 // I could be more memory efficient if I save histories to a Game class instead of players.
 // Right now there is a duplication of data (for two players)
 //
+// Untracked players don't allocate anything on the heap. Memory per player:
+//   doubles: 3×8 (ratings) + 3×4 (id, games, region) + 2×4 (position) + 8 (history pointer) = 56 B
+//   PSIM_FLOAT_RATINGS: 3×4 + 3×4 + 2×4 + 8 = 40 B
+// Simulation adds 8 B per player (skill_by_id) and the candidate index 12 B per player.
+// Tracked players additionally allocate PlayerHistory (~250 B + recorded games).
+//
 
 class Player
 {
 public:
     // Actual player skill
-    double skill;
+    rating_t skill;
     // MMR assigned by the matchmaker
-    double mmr = 2820 / 2.2;
+    rating_t mmr = static_cast<rating_t>(2820 / 2.2);
     // Uncertainity
-    double sigma = 0;
-    // Vector of opponent skills.
-    std::unique_ptr<std::vector<double>> opponent_history;
-    // MMR history
-    std::unique_ptr<std::vector<double>> mmr_history;
-    // Chances predicted by the matchmaker
-    std::unique_ptr<std::vector<double>> predicted_chances;
-    // How sigma changes
-    std::unique_ptr<std::vector<double>> sigma_history;
+    rating_t sigma = 0;
+    // Unique id (order in which players were added to the simulation)
+    int id = 0;
+    // Number of games played. Histories might not record every game so this is tracked separately.
+    int games_played = 0;
+    // Region and position on the latency map (see LatencyModel)
+    int region = 0;
+    float x = 0;
+    float y = 0;
+    // Opponent skills, MMR, predicted chances and sigma for each game (only for tracked players)
+    std::unique_ptr<PlayerHistory> history;
+
+    // Placeholder for players initialized in bulk (see Simulation::add_players)
+    Player() : skill(0) {}
 
     // Define player and assign him his skill value
     Player(double pskill)
     {
-        skill = pskill;
-        opponent_history.reset(new std::vector<double>);
-        mmr_history.reset(new std::vector<double>);
-        predicted_chances.reset(new std::vector<double>);
-        sigma_history.reset(new std::vector<double>);
+        skill = static_cast<rating_t>(pskill);
+    }
+
+    // Untracked player
+    Player(double pskill, int pid)
+    {
+        skill = static_cast<rating_t>(pskill);
+        id = pid;
+    }
+
+    // Tracked player
+    Player(double pskill, int pid, HistoryEncoding encoding, bool track_sigma, int record_every = 1)
+    {
+        skill = static_cast<rating_t>(pskill);
+        id = pid;
+        history = std::make_unique<PlayerHistory>(encoding, track_sigma, record_every);
+    }
+
+    // Starts recording games into a new history
+    void start_tracking(HistoryEncoding encoding, bool track_sigma, int record_every = 1)
+    {
+        history = std::make_unique<PlayerHistory>(encoding, track_sigma, record_every);
+    }
+
+    // Stops recording games and frees the history
+    void stop_tracking()
+    {
+        history.reset();
+    }
+
+    // Saves the state before a game against `opponent` and counts the game. `predicted_chance` is the chance
+    // of this player winning as predicted by the matchmaker. Strategies call this once per player per game.
+    void record_game(Player &opponent, double predicted_chance)
+    {
+        if (history && history->should_record(games_played))
+            history->record(opponent.skill, opponent.id, mmr, sigma, predicted_chance);
+        games_played++;
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,225 @@
+#include "aggregates.h"
+
+#include <algorithm>
+#include <cmath>
+
+//
+// BINNED SERIES
+//
+
+BinnedSeries::BinnedSeries(int bins)
+{
+    sum.assign(bins, 0.0);
+    sum_sq.assign(bins, 0.0);
+    count.assign(bins, 0);
+}
+
+void BinnedSeries::add(int bin, double value)
+{
+    sum[bin] += value;
+    sum_sq[bin] += value * value;
+    count[bin]++;
+}
+
+// Merges neighbouring bins, the second half becomes empty
+void BinnedSeries::merge_pairs()
+{
+    size_t half = (sum.size() + 1) / 2;
+    for (size_t i = 0; i < half; i++)
+    {
+        size_t a = 2 * i, b = std::min(2 * i + 1, sum.size());
+        sum[i] = sum[a] + (b < sum.size() ? sum[b] : 0);
+        sum_sq[i] = sum_sq[a] + (b < sum.size() ? sum_sq[b] : 0);
+        count[i] = count[a] + (b < sum.size() ? count[b] : 0);
+    }
+    std::fill(sum.begin() + half, sum.end(), 0.0);
+    std::fill(sum_sq.begin() + half, sum_sq.end(), 0.0);
+    std::fill(count.begin() + half, count.end(), 0);
+}
+
+void BinnedSeries::resize(int bins)
+{
+    sum.resize(bins);
+    sum_sq.resize(bins);
+    count.resize(bins);
+}
+
+std::vector<double> BinnedSeries::means() const
+{
+    std::vector<double> out(sum.size(), 0.0);
+    for (size_t i = 0; i < sum.size(); i++)
+        if (count[i] > 0)
+            out[i] = sum[i] / count[i];
+    return out;
+}
+
+std::vector<double> BinnedSeries::stdevs() const
+{
+    std::vector<double> out(sum.size(), 0.0);
+    for (size_t i = 0; i < sum.size(); i++)
+    {
+        if (count[i] == 0)
+            continue;
+        double mean = sum[i] / count[i];
+        out[i] = sqrt(std::max(0.0, sum_sq[i] / count[i] - mean * mean));
+    }
+    return out;
+}
+
+double BinnedSeries::total() const
+{
+    double t = 0;
+    for (double s : sum)
+        t += s;
+    return t;
+}
+
+//
+// HISTOGRAM
+//
+
+Histogram::Histogram(const std::vector<double> &x, int x_bins)
+{
+    x_edges = make_edges(x, x_bins);
+    counts.assign(x_bins, 0.0);
+    for (double v : x)
+        counts[find_bin(x_edges, v)]++;
+}
+
+Histogram::Histogram(const std::vector<double> &x, const std::vector<double> &y, int x_bins, int y_bins)
+{
+    x_edges = make_edges(x, x_bins);
+    y_edges = make_edges(y, y_bins);
+    counts.assign(x_bins * y_bins, 0.0);
+    for (size_t i = 0; i < x.size(); i++)
+        counts[find_bin(x_edges, x[i]) * y_bins + find_bin(y_edges, y[i])]++;
+}
+
+// Evenly spaced edges between min and max value (bins + 1 values)
+std::vector<double> Histogram::make_edges(const std::vector<double> &values, int bins)
+{
+    double lo = 0, hi = 1;
+    if (!values.empty())
+    {
+        auto minmax = std::minmax_element(values.begin(), values.end());
+        lo = *minmax.first;
+        hi = *minmax.second;
+    }
+    if (hi <= lo)
+        hi = lo + 1;
+
+    std::vector<double> edges(bins + 1);
+    for (int i = 0; i <= bins; i++)
+        edges[i] = lo + (hi - lo) * i / bins;
+    return edges;
+}
+
+int Histogram::find_bin(const std::vector<double> &edges, double value)
+{
+    int bins = static_cast<int>(edges.size()) - 1;
+    int b = static_cast<int>((value - edges[0]) / (edges[bins] - edges[0]) * bins);
+    return std::max(0, std::min(bins - 1, b));
+}
+
+//
+// AGGREGATES
+//
+
+Aggregates::Aggregates(long long total_games, int bins, int percentile_groups)
+{
+    m_total_games = std::max(1LL, total_games);
+    m_bins = std::max(1, bins);
+    m_used_bins = m_bins;
+    m_percentile_groups = std::max(1, percentile_groups);
+    prediction_difference = BinnedSeries(m_bins);
+    match_accuracy = BinnedSeries(m_bins);
+    good_match_fraction = BinnedSeries(m_bins);
+    percentile_convergence.assign(m_percentile_groups, BinnedSeries(m_bins));
+    latency = BinnedSeries(m_bins);
+    match_accuracy_by_latency = BinnedSeries(LATENCY_BINS);
+}
+
+// Bin for the game index. Games past `total_games` go to the last bin.
+int Aggregates::bin(long long game) const
+{
+    return static_cast<int>(std::min<long long>(m_bins - 1, game * m_bins / m_total_games));
+}
+
+std::vector<double> Aggregates::bin_starts() const
+{
+    std::vector<double> out(m_used_bins);
+    for (int i = 0; i < m_used_bins; i++)
+        out[i] = static_cast<double>(m_total_games * i / m_bins);
+    return out;
+}
+
+void Aggregates::grow(long long game)
+{
+    while (m_growable && game >= m_total_games)
+    {
+        m_total_games *= 2;
+        for (BinnedSeries *series : {&prediction_difference, &match_accuracy, &good_match_fraction, &latency})
+            series->merge_pairs();
+        for (BinnedSeries &series : percentile_convergence)
+            series.merge_pairs();
+    }
+}
+
+void Aggregates::add_game(long long game, double pred_diff, double match_acc, double percentile1, double percentile2)
+{
+    grow(game);
+    int b = bin(game);
+    prediction_difference.add(b, pred_diff);
+    match_accuracy.add(b, match_acc);
+
+    for (double percentile : {percentile1, percentile2})
+    {
+        if (std::isnan(percentile))
+            continue;
+        int group = static_cast<int>(percentile / 100 * m_percentile_groups);
+        group = std::max(0, std::min(m_percentile_groups - 1, group));
+        percentile_convergence[group].add(b, pred_diff);
+    }
+}
+
+void Aggregates::add_good_match_fraction(long long game, double fraction)
+{
+    grow(game);
+    good_match_fraction.add(bin(game), fraction);
+}
+
+// Latencies above the last bin go to the last bin
+void Aggregates::add_latency(long long game, double match_latency, double match_acc)
+{
+    has_latency = true;
+    grow(game);
+    latency.add(bin(game), match_latency);
+    int latency_bin = std::min(LATENCY_BINS - 1, static_cast<int>(match_latency / LATENCY_BIN_WIDTH));
+    match_accuracy_by_latency.add(latency_bin, match_acc);
+}
+
+std::vector<double> Aggregates::latency_bin_starts() const
+{
+    std::vector<double> out(LATENCY_BINS);
+    for (int i = 0; i < LATENCY_BINS; i++)
+        out[i] = i * LATENCY_BIN_WIDTH;
+    return out;
+}
+
+void Aggregates::truncate(long long games)
+{
+    m_used_bins = bin(std::max(0LL, games - 1)) + 1;
+    for (BinnedSeries *series : {&prediction_difference, &match_accuracy, &good_match_fraction, &latency})
+        series->resize(m_used_bins);
+    for (BinnedSeries &series : percentile_convergence)
+        series.resize(m_used_bins);
+}
+
+size_t Aggregates::bytes() const
+{
+    size_t total = prediction_difference.bytes() + match_accuracy.bytes() + good_match_fraction.bytes() +
+                   latency.bytes() + match_accuracy_by_latency.bytes();
+    for (const BinnedSeries &series : percentile_convergence)
+        total += series.bytes();
+    return total;
+}
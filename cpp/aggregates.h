@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <limits>
+
+//
+// AGGREGATES
+// Binned statistics computed during the simulation so we don't have to export raw vectors with
+// hundreds of millions of elements and post-process them in Python.
+//
+
+// Running sum and sum of squares for each bin
+class BinnedSeries
+{
+public:
+    std::vector<double> sum;
+    std::vector<double> sum_sq;
+    std::vector<long long> count;
+
+    BinnedSeries(){};
+    BinnedSeries(int bins);
+    void add(int bin, double value);
+    void resize(int bins);
+    void merge_pairs();
+    std::vector<double> means() const;
+    std::vector<double> stdevs() const;
+    double total() const;
+    size_t bytes() const { return sum.capacity() * sizeof(double) + sum_sq.capacity() * sizeof(double) + count.capacity() * sizeof(long long); }
+};
+
+// Simple 1D/2D histogram with fixed edges
+class Histogram
+{
+public:
+    std::vector<double> x_edges;
+    std::vector<double> y_edges;
+    std::vector<double> counts; // row-major [x][y]
+
+    Histogram(const std::vector<double> &x, int x_bins);
+    Histogram(const std::vector<double> &x, const std::vector<double> &y, int x_bins, int y_bins);
+
+private:
+    static std::vector<double> make_edges(const std::vector<double> &values, int bins);
+    static int find_bin(const std::vector<double> &edges, double value);
+};
+
+class Aggregates
+{
+    long long m_total_games;
+    int m_bins;
+    // Bins are merged when games go past `m_total_games` (see `grow`)
+    bool m_growable = false;
+    // Bins returned (less than `m_bins` after `truncate`)
+    int m_used_bins;
+    int m_percentile_groups;
+
+public:
+    // Windowed series over the game index
+    BinnedSeries prediction_difference;
+    BinnedSeries match_accuracy;
+    BinnedSeries good_match_fraction;
+    // Prediction difference for each skill percentile group ([group][bin])
+    std::vector<BinnedSeries> percentile_convergence;
+    // Latency of matches over the game index, and match accuracy depending on latency
+    bool has_latency = false;
+    BinnedSeries latency;
+    BinnedSeries match_accuracy_by_latency;
+    static constexpr int LATENCY_BINS = 30;
+    static constexpr double LATENCY_BIN_WIDTH = 10;
+
+    Aggregates(long long total_games, int bins, int percentile_groups);
+    int bin(long long game) const;
+    int bins() const { return m_used_bins; }
+    int percentile_groups() const { return m_percentile_groups; }
+    // Game index where each bin starts
+    std::vector<double> bin_starts() const;
+    // `percentile1` and `percentile2` are skill percentiles (0-100) of both players (NaN if unknown)
+    void add_game(long long game, double pred_diff, double match_acc,
+                  double percentile1 = std::numeric_limits<double>::quiet_NaN(),
+                  double percentile2 = std::numeric_limits<double>::quiet_NaN());
+    void add_good_match_fraction(long long game, double fraction);
+    void add_latency(long long game, double match_latency, double match_acc);
+    // Start of each latency bin (ms)
+    std::vector<double> latency_bin_starts() const;
+    // Drops bins after game `games` (for simulations that stopped early)
+    void truncate(long long games);
+    // Lets `total_games` be an estimate: when a game goes past it, the total is doubled and neighbouring
+    // bins are merged (exact, bin edges stay aligned). Call `truncate` at the end to drop unused bins.
+    void set_growable() { m_growable = true; }
+    size_t bytes() const;
+
+private:
+    // Doubles the total (merging bins) until `game` fits, if growable
+    void grow(long long game);
+};
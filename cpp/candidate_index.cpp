@@ -0,0 +1,163 @@
+#include "candidate_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+CandidateIndex::CandidateIndex(const LatencyModel *model, double max_latency)
+{
+    m_model = model;
+    m_max_latency = max_latency;
+    if (model && max_latency > 0)
+        m_reach = max_latency - model->base_latency;
+    else
+        m_reach = std::numeric_limits<double>::infinity();
+    m_buckets.resize(1);
+}
+
+// Cells are as large as the reach, so a search covers about 3×3 cells. Sparse populations get larger cells,
+// so there are never many more cells than players.
+void CandidateIndex::update_grid(const std::vector<Player> &players)
+{
+    m_columns = m_rows = 1;
+    m_min_x = m_min_y = 0;
+    m_cell = 1;
+    if (std::isfinite(m_reach) && !players.empty())
+    {
+        double max_x = -std::numeric_limits<double>::infinity();
+        double max_y = max_x;
+        m_min_x = m_min_y = std::numeric_limits<double>::infinity();
+        for (const Player &p : players)
+        {
+            m_min_x = std::min<double>(m_min_x, p.x);
+            m_min_y = std::min<double>(m_min_y, p.y);
+            max_x = std::max<double>(max_x, p.x);
+            max_y = std::max<double>(max_y, p.y);
+        }
+        double width = max_x - m_min_x;
+        double height = max_y - m_min_y;
+        double max_cells = std::max<double>(1, players.size() / 16.0);
+        m_cell = std::max({m_reach, sqrt(width * height / max_cells), std::max(width, height) / max_cells, 1e-6});
+        m_columns = static_cast<int>(width / m_cell) + 1;
+        m_rows = static_cast<int>(height / m_cell) + 1;
+    }
+    m_buckets.assign(static_cast<size_t>(m_columns) * m_rows, Bucket());
+}
+
+int CandidateIndex::column(double x) const
+{
+    return std::max(0, std::min(m_columns - 1, static_cast<int>(std::floor((x - m_min_x) / m_cell))));
+}
+
+int CandidateIndex::row(double y) const
+{
+    return std::max(0, std::min(m_rows - 1, static_cast<int>(std::floor((y - m_min_y) / m_cell))));
+}
+
+void CandidateIndex::rebuild(const std::vector<Player> &players)
+{
+    // Positions only change when players are added or removed
+    if (m_dirty)
+        update_grid(players);
+    for (Bucket &bucket : m_buckets)
+        bucket.players.clear();
+    for (int i = 0; i < static_cast<int>(players.size()); i++)
+        m_buckets[static_cast<size_t>(row(players[i].y)) * m_columns + column(players[i].x)].players.push_back(i);
+
+    // Sorted as (mmr, player) pairs, so comparisons don't jump around the players vector
+    std::vector<std::pair<double, int>> sorted;
+    for (Bucket &bucket : m_buckets)
+    {
+        sorted.clear();
+        for (int i : bucket.players)
+            sorted.push_back({players[i].mmr, i});
+        std::sort(sorted.begin(), sorted.end());
+        bucket.mmr.resize(sorted.size());
+        for (size_t i = 0; i < sorted.size(); i++)
+        {
+            bucket.mmr[i] = sorted[i].first;
+            bucket.players[i] = sorted[i].second;
+        }
+    }
+
+    m_games_since_rebuild = 0;
+    m_dirty = false;
+}
+
+// Finds candidates for `player`: players with MMR within `mmr_window` in cells within latency reach.
+// Returns the number of candidates. Pick from them with `random_candidate`.
+size_t CandidateIndex::find_candidates(const std::vector<Player> &players, int player, double mmr_window)
+{
+    long long limit = rebuild_every > 0 ? rebuild_every : static_cast<long long>(players.size());
+    if (m_dirty || m_games_since_rebuild >= limit)
+        rebuild(players);
+
+    const Player &p = players[player];
+    m_ranges.clear();
+    m_total = 0;
+    if (m_reach < 0)
+        return 0;
+
+    int first_column = 0, last_column = 0, first_row = 0, last_row = 0;
+    if (std::isfinite(m_reach))
+    {
+        first_column = column(p.x - m_reach);
+        last_column = column(p.x + m_reach);
+        first_row = row(p.y - m_reach);
+        last_row = row(p.y + m_reach);
+    }
+    for (int r = first_row; r <= last_row; r++)
+        for (int c = first_column; c <= last_column; c++)
+        {
+            // Distance from the player to the nearest point of the cell
+            if (std::isfinite(m_reach))
+            {
+                double left = m_min_x + c * m_cell;
+                double bottom = m_min_y + r * m_cell;
+                double dx = std::max({0.0, left - p.x, p.x - (left + m_cell)});
+                double dy = std::max({0.0, bottom - p.y, p.y - (bottom + m_cell)});
+                if (dx * dx + dy * dy > m_reach * m_reach)
+                    continue;
+            }
+            int cell = r * m_columns + c;
+            const std::vector<double> &mmr = m_buckets[cell].mmr;
+            if (mmr.empty())
+                continue;
+            // Cells entirely inside the window (e.g. early on, when everyone has the starting MMR) need no search
+            double low = p.mmr - mmr_window;
+            double high = p.mmr + mmr_window;
+            auto lo = mmr.front() >= low ? mmr.begin() : std::lower_bound(mmr.begin(), mmr.end(), low);
+            auto hi = mmr.back() <= high ? mmr.end() : std::upper_bound(lo, mmr.end(), high);
+            if (lo == hi)
+                continue;
+            m_ranges.push_back({cell, static_cast<int>(lo - mmr.begin()), static_cast<int>(hi - mmr.begin())});
+            m_total += hi - lo;
+        }
+    return m_total;
+}
+
+// Returns index of a random player from the last `find_candidates` (-1 if there were none)
+int CandidateIndex::random_candidate(std::default_random_engine &rng)
+{
+    if (m_total == 0)
+        return -1;
+
+    // Uniform pick across all ranges
+    size_t pick = rng() % m_total;
+    for (const Range &range : m_ranges)
+    {
+        size_t size = range.end - range.begin;
+        if (pick < size)
+            return m_buckets[range.cell].players[range.begin + pick];
+        pick -= size;
+    }
+    return -1;
+}
+
+size_t CandidateIndex::bytes() const
+{
+    size_t total = m_buckets.capacity() * sizeof(Bucket);
+    for (const Bucket &bucket : m_buckets)
+        total += bucket.mmr.capacity() * sizeof(double) + bucket.players.capacity() * sizeof(int);
+    return total;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "player.h"
+#include "latency.h"
+
+#include <vector>
+#include <random>
+
+//
+// CANDIDATE INDEX
+// Players bucketed by position into a grid of square cells and sorted by MMR inside each cell. Finding an opponent
+// is a binary search for the MMR window in the cells that are within latency reach of the player (nearest point
+// of the cell at most `max_latency - base_latency` away) instead of trying random players from the whole population.
+// Cells are as large as the reach, so the searched cells hold roughly 3× more players than the reach circle.
+// Candidates it returns are still checked with `good_match` (which checks the exact latency), so players in
+// the corners of boundary cells only cost an extra try.
+// MMR changes after each game, so the index is rebuilt periodically. A slightly stale index only makes the search
+// a bit less precise. Without a latency limit there is a single cell.
+//
+
+class CandidateIndex
+{
+    // Players of a cell sorted by MMR. MMRs are kept separately so binary search touches less memory.
+    struct Bucket
+    {
+        std::vector<double> mmr;
+        std::vector<int> players;
+    };
+    // Candidates of one cell from the last search
+    struct Range
+    {
+        int cell;
+        int begin;
+        int end;
+    };
+    std::vector<Bucket> m_buckets;
+    const LatencyModel *m_model;
+    double m_max_latency;
+    // Largest distance of two players that can be matched (< 0 → nobody can be matched, infinite → no limit)
+    double m_reach;
+    // Grid (updated when players are added or removed)
+    double m_min_x = 0;
+    double m_min_y = 0;
+    double m_cell = 1;
+    int m_columns = 1;
+    int m_rows = 1;
+    std::vector<Range> m_ranges;
+    size_t m_total = 0;
+    long long m_games_since_rebuild = 0;
+    bool m_dirty = true;
+
+    void update_grid(const std::vector<Player> &players);
+    int column(double x) const;
+    int row(double y) const;
+
+public:
+    // Rebuild after this many games (0 → number of players)
+    long long rebuild_every = 0;
+
+    CandidateIndex(const LatencyModel *model, double max_latency);
+    // Forces rebuild before the next search (players added or removed)
+    void invalidate() { m_dirty = true; }
+    void game_played() { m_games_since_rebuild++; }
+    void rebuild(const std::vector<Player> &players);
+    size_t find_candidates(const std::vector<Player> &players, int player, double mmr_window);
+    int random_candidate(std::default_random_engine &rng);
+    size_t bytes() const;
+};
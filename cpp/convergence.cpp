@@ -0,0 +1,108 @@
+#include "convergence.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// Ranks starting from 0, tied values get their average rank
+static std::vector<double> ranks(const std::vector<double> &values)
+{
+    std::vector<size_t> order(values.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return values[a] < values[b]; });
+
+    std::vector<double> out(values.size());
+    for (size_t i = 0; i < order.size();)
+    {
+        size_t j = i;
+        while (j + 1 < order.size() && values[order[j + 1]] == values[order[i]])
+            j++;
+        double rank = (i + j) / 2.0;
+        for (size_t k = i; k <= j; k++)
+            out[order[k]] = rank;
+        i = j + 1;
+    }
+    return out;
+}
+
+double rank_correlation(const std::vector<double> &x, const std::vector<double> &y)
+{
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    if (x.size() < 2 || x.size() != y.size())
+        return nan;
+    std::vector<double> rx = ranks(x);
+    std::vector<double> ry = ranks(y);
+    double mean = (x.size() - 1) / 2.0;
+    double cov = 0, var_x = 0, var_y = 0;
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        cov += (rx[i] - mean) * (ry[i] - mean);
+        var_x += (rx[i] - mean) * (rx[i] - mean);
+        var_y += (ry[i] - mean) * (ry[i] - mean);
+    }
+    if (var_x == 0 || var_y == 0)
+        return nan;
+    return cov / sqrt(var_x * var_y);
+}
+
+void ConvergenceCheck::check(const std::vector<Player> &players, long long games_played, long long rating_updates)
+{
+    m_rating_updates = rating_updates;
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    double window_prediction = m_window_games > 0 ? m_pred_sum / m_window_games : nan;
+    m_pred_sum = 0;
+    m_window_games = 0;
+
+    // Evenly spaced players. Those with unknown skill only count for sigma.
+    std::vector<double> skills, mmrs, sigmas;
+    size_t step = std::max<size_t>(1, players.size() / SAMPLE);
+    for (size_t i = 0; i < players.size(); i += step)
+    {
+        sigmas.push_back(players[i].sigma);
+        if (std::isnan(players[i].skill))
+            continue;
+        skills.push_back(players[i].skill);
+        mmrs.push_back(players[i].mmr);
+    }
+    double correlation = ::rank_correlation(skills, mmrs);
+    double sigma = nan;
+    if (!sigmas.empty())
+    {
+        std::nth_element(sigmas.begin(), sigmas.begin() + sigmas.size() / 2, sigmas.end());
+        sigma = sigmas[sigmas.size() / 2];
+    }
+
+    // Comparisons with NaN are false, so a criterion without a previous value (or a value at all) fails
+    bool passed = true;
+    if (m_criteria.prediction_tolerance > 0)
+    {
+        double previous = m_has_previous ? prediction_difference.back() : nan;
+        passed &= std::abs(window_prediction - previous) < m_criteria.prediction_tolerance * previous;
+    }
+    if (m_criteria.correlation_tolerance > 0)
+    {
+        double previous = m_has_previous ? rank_correlation.back() : nan;
+        passed &= std::abs(correlation - previous) < m_criteria.correlation_tolerance;
+    }
+    if (m_criteria.sigma_threshold > 0)
+        passed &= sigma < m_criteria.sigma_threshold;
+
+    games.push_back(static_cast<double>(games_played));
+    prediction_difference.push_back(window_prediction);
+    rank_correlation.push_back(correlation);
+    median_sigma.push_back(sigma);
+    m_has_previous = true;
+
+    m_passed = passed ? m_passed + 1 : 0;
+    if (m_passed >= m_criteria.patience && !converged())
+        converged_at = games_played;
+}
+
+void ConvergenceCheck::reset()
+{
+    m_pred_sum = 0;
+    m_window_games = 0;
+    m_passed = 0;
+    m_has_previous = false;
+    converged_at = -1;
+}
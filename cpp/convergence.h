@@ -0,0 +1,74 @@
+#pragma once
+
+#include "player.h"
+
+#include <limits>
+#include <vector>
+
+//
+// CONVERGENCE CHECK
+// Stops a simulation once ratings stopped changing in a meaningful way, instead of playing all games.
+// Every `every` games the enabled criteria are evaluated and the simulation is converged when all of them pass
+// for `patience` checks in a row. A check waits until ratings changed since the previous one, otherwise strategies
+// that update ratings in periods (Glicko-2) would compare identical ratings and converge immediately.
+// The population is estimated from evenly spaced players, so a check costs about the same for any population size.
+//
+
+struct ConvergenceCriteria
+{
+    // Minimum games between checks
+    int every = 10000;
+    // Mean prediction difference of the last window changed by less than this fraction of the previous one (0 → off)
+    double prediction_tolerance = 0;
+    // MMR-skill rank correlation changed by less than this since the previous check (0 → off)
+    double correlation_tolerance = 0;
+    // Median sigma is below this (0 → off). Only useful for strategies that use sigma.
+    double sigma_threshold = 0;
+    // Consecutive checks that have to pass
+    int patience = 3;
+
+    bool enabled() const { return prediction_tolerance > 0 || correlation_tolerance > 0 || sigma_threshold > 0; }
+};
+
+class ConvergenceCheck
+{
+    static constexpr size_t SAMPLE = 4096;
+    ConvergenceCriteria m_criteria;
+    double m_pred_sum = 0;
+    long long m_window_games = 0;
+    int m_passed = 0;
+    // Whether the last values of the check vectors can be compared with (not before the first check or after reset)
+    bool m_has_previous = false;
+    // Rating updates of the strategy at the previous check (kept on reset, so ratings have to change after it too)
+    long long m_rating_updates = 0;
+
+public:
+    // Values at each check
+    std::vector<double> games;
+    std::vector<double> prediction_difference;
+    std::vector<double> rank_correlation;
+    std::vector<double> median_sigma;
+    // Games played when the simulation converged (-1 → not converged)
+    long long converged_at = -1;
+
+    ConvergenceCheck(const ConvergenceCriteria &criteria) : m_criteria(criteria){};
+    bool converged() const { return converged_at >= 0; }
+    // Adds a game to the window
+    void add_game(double pred_diff)
+    {
+        m_pred_sum += pred_diff;
+        m_window_games++;
+    }
+    // Whether a check is due, given `MatchmakingStrategy::rating_updates` (-1 → ratings change every game)
+    bool due(long long rating_updates) const
+    {
+        return m_window_games >= m_criteria.every && (rating_updates < 0 || rating_updates != m_rating_updates);
+    }
+    // Evaluates the criteria after `games_played` games
+    void check(const std::vector<Player> &players, long long games_played, long long rating_updates);
+    // Starts over, e.g. when new players join. Values of previous checks are kept.
+    void reset();
+};
+
+// Spearman rank correlation (ties get average ranks). NaN if either side is constant.
+double rank_correlation(const std::vector<double> &x, const std::vector<double> &y);
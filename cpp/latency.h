@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <random>
+#include <cmath>
+
+//
+// LATENCY MODEL
+// Players live in regions placed on a circle. Each player gets a position around his region center
+// and latency between two players grows with their distance (units are milliseconds).
+//
+
+class LatencyModel
+{
+    std::vector<double> m_center_x;
+    std::vector<double> m_center_y;
+    std::normal_distribution<> m_spread;
+
+public:
+    // Latency between two players at the same position
+    double base_latency = 10;
+    // Latency between neighbouring region centers
+    double region_distance = 80;
+    // Standard deviation of player positions around the region center
+    double region_spread = 15;
+
+    LatencyModel(int regions)
+    {
+        // Regions on a circle so neighbouring centers are `region_distance` apart
+        const double pi = 3.14159265358979323846;
+        double radius = regions > 1 ? region_distance / (2 * sin(pi / regions)) : 0;
+        for (int r = 0; r < regions; r++)
+        {
+            m_center_x.push_back(radius * cos(2 * pi * r / regions));
+            m_center_y.push_back(radius * sin(2 * pi * r / regions));
+        }
+        m_spread = std::normal_distribution<>(0, region_spread);
+    }
+
+    int regions() const { return static_cast<int>(m_center_x.size()); }
+
+    // Assigns a random region and position. Can be called from several threads with their own `rng`.
+    template <typename RNG>
+    void place(RNG &rng, int &region, float &x, float &y) const
+    {
+        std::normal_distribution<> spread = m_spread;
+        region = static_cast<int>(rng() % regions());
+        x = static_cast<float>(m_center_x[region] + spread(rng));
+        y = static_cast<float>(m_center_y[region] + spread(rng));
+    }
+
+    double latency(double x1, double y1, double x2, double y2) const
+    {
+        return base_latency + sqrt((x1 - x2) * (x1 - x2) + (y1 - y2) * (y1 - y2));
+    }
+
+    // Latency between region centers
+    double region_latency(int r1, int r2) const
+    {
+        return latency(m_center_x[r1], m_center_y[r1], m_center_x[r2], m_center_y[r2]);
+    }
+};
@@ -3,15 +3,17 @@
 #include "strategies.h"
 #include "simulation.h"
 #include "main.h"
+#include "plugins.h"
+#include "python_strategy.h"
 
 #include <iostream>
 #include <string>
 #include <memory>
+#include <algorithm>
 
-// Creates simulation, runs it, and returns a reference to it
-Simulation run_sim(int players, int iterations, int sp1, int sp2, int sp3, double sp4, const std::string &strategy_type, bool gradual)
+// Creates strategy by its name and parameters (-1 → strategy default)
+std::unique_ptr<MatchmakingStrategy> make_strategy(int sp1, int sp2, int sp3, double sp4, const std::string &strategy_type)
 {
-    Timeit t;
     std::unique_ptr<MatchmakingStrategy> strategy;
     if ((strategy_type == "tweaked_elo") || (strategy_type == "default"))
         strategy = std::make_unique<Tweaked_ELO_strategy>(sp1, sp2, sp3);
@@ -23,21 +25,113 @@ Simulation run_sim(int players, int iterations, int sp1, int sp2, int sp3, doubl
         strategy = std::make_unique<Naive_strategy>(sp1, sp2);
     else if (strategy_type == "trueskill")
         strategy = std::make_unique<Trueskill_strategy>();
+    else if (strategy_type == "glicko2")
+        strategy = std::make_unique<Glicko2_strategy>(sp1, sp4);
+    else if (strategy_type == "python_batch")
+        strategy = std::make_unique<Python_batch_strategy>(batch_strategy_config);
     else
+        strategy = StrategyRegistry::instance().create(strategy_type, sp1, sp2, sp3, sp4);
+    if (!strategy)
         print("ERROR: Invalid strategy type!!!");
+    return strategy;
+}
 
-    Simulation sim = Simulation(std::move(strategy));
+// Whether the strategy records sigma into histories (needed for memory estimates).
+// Answered from the name, so nothing is created just to ask.
+bool strategy_uses_sigma(const std::string &strategy_type)
+{
+    if (strategy_type == "trueskill" || strategy_type == "glicko2")
+        return true;
+    if (strategy_type == "python_batch")
+        return batch_strategy_config.uses_sigma;
+    const psim_strategy *plugin = StrategyRegistry::instance().find(strategy_type);
+    return plugin && plugin->uses_sigma != 0;
+}
+
+// Built-in strategies created by `make_strategy` ("default" is an alias of tweaked_elo)
+const std::vector<std::string> &builtin_strategies()
+{
+    static const std::vector<std::string> names = {"naive", "elo", "tweaked_elo", "tweaked2_elo", "trueskill", "glicko2", "python_batch"};
+    return names;
+}
+
+bool is_builtin_strategy(const std::string &strategy_type)
+{
+    const std::vector<std::string> &names = builtin_strategies();
+    return strategy_type == "default" || std::find(names.begin(), names.end(), strategy_type) != names.end();
+}
 
-    // For Trueskill we will want different default player parameters
-    if (strategy_type == "trueskill")
+// Creates simulation with the strategy and options. `total_games` is used for progress and aggregate bins.
+Simulation create_sim(long long total_games, int sp1, int sp2, int sp3, double sp4, const std::string &strategy_type, const SimulationOptions &options)
+{
+    std::unique_ptr<MatchmakingStrategy> strategy = make_strategy(sp1, sp2, sp3, sp4, strategy_type);
+    // Some strategies want different default player parameters
+    double force_mmr = strategy->initial_mmr();
+    double force_sigma = strategy->initial_sigma();
+
+    // Players in regions, good matches need low enough latency
+    std::unique_ptr<LatencyModel> latency_model;
+    if (options.regions > 0)
+    {
+        latency_model = std::make_unique<LatencyModel>(options.regions);
+        if (options.max_latency > 0)
+            strategy = std::make_unique<Latency_strategy>(std::move(strategy), latency_model.get(), options.max_latency);
+    }
+
+    Simulation sim = Simulation(std::move(strategy));
+    if (options.candidate_index)
+        sim.candidate_index = std::make_unique<CandidateIndex>(latency_model.get(), options.max_latency);
+    if (options.seed >= 0)
+        sim.seed(static_cast<unsigned int>(options.seed));
+    sim.latency_model = std::move(latency_model);
+    sim.m_history_encoding = options.history_encoding;
+    sim.m_tracking = options.tracking;
+    sim.m_track_sample = options.track_sample;
+    sim.m_track_percentile_min = options.track_percentile_min;
+    sim.m_track_percentile_max = options.track_percentile_max;
+    sim.m_track_every = options.track_every;
+    sim.m_record_raw = options.record_raw;
+    sim.m_good_match_sample = options.good_match_sample;
+    sim.progress = options.progress;
+    if (!options.metrics_shm.empty())
     {
-        sim.m_force_player_mmr = 25.0;
-        sim.m_force_player_sigma = 25. / 3;
+        if (!sim.progress)
+            sim.progress = std::make_shared<SimulationProgress>();
+        sim.progress->publish_every = options.metrics_every;
+        // Python functions open the ring before starting, so a taken name is reported to the caller
+        if (!sim.progress->has_ring())
+        {
+            std::string error = sim.progress->open_ring(options.metrics_shm, options.metrics_capacity);
+            if (!error.empty())
+                print("ERROR:", error);
+        }
     }
+    if (sim.progress)
+        sim.progress->target_games = total_games;
+    if (options.aggregate_bins > 0)
+        sim.aggregates = std::make_unique<Aggregates>(total_games, options.aggregate_bins, options.percentile_groups);
+    if (options.convergence.enabled())
+        sim.convergence = std::make_unique<ConvergenceCheck>(options.convergence);
+
+    sim.skill_distribution = options.skill_distribution;
+    sim.m_force_player_mmr = force_mmr;
+    sim.m_force_player_sigma = force_sigma;
+
+    return sim;
+}
+
+// Creates simulation, runs it, and returns a reference to it
+Simulation run_sim(int players, int iterations, int sp1, int sp2, int sp3, double sp4, const std::string &strategy_type, bool gradual, const SimulationOptions &options)
+{
+    Timeit t;
+    Simulation sim = create_sim(iterations, sp1, sp2, sp3, sp4, strategy_type, options);
 
     if (gradual)
     {
         std::cout << "Add players gradually" << std::endl;
+        // Later phases would otherwise reallocate players and briefly hold both copies
+        sim.players.reserve(players);
+        sim.skill_by_id.reserve(players);
         sim.add_players(players * 0.5);
         sim.play_games(iterations * 0.4);
         sim.add_players(players * 0.3);
@@ -52,9 +146,75 @@ Simulation run_sim(int players, int iterations, int sp1, int sp2, int sp3, doubl
         sim.play_games(iterations);
     }
 
+    if (sim.convergence && sim.convergence->converged())
+        print("Converged after", sim.convergence->converged_at, "games");
+    if (sim.convergence && sim.aggregates && sim.total_games_played < iterations)
+        sim.aggregates->truncate(sim.total_games_played);
+    if (sim.progress)
+        sim.progress->finish();
     print("Simulation finished in", t.s(), "seconds");
 
     // I can just return the class. The compiler will do return-value-optimization
     // and correctly move this object into a new variable without copying.
     return sim;
 }
+
+// Creates simulation and replays all matches from the log with it
+Simulation replay_sim(MatchLog &log, int sp1, int sp2, int sp3, double sp4, const std::string &strategy_type, const SimulationOptions &options)
+{
+    Timeit t;
+    // CSV counts are estimates, aggregates adjust their bins to the actual number of games
+    Simulation sim = create_sim(log.count(), sp1, sp2, sp3, sp4, strategy_type, options);
+    if (sim.aggregates)
+        sim.aggregates->set_growable();
+    long long games = sim.replay(log);
+    if (sim.aggregates)
+        sim.aggregates->truncate(games);
+
+    if (sim.progress)
+        sim.progress->finish();
+    print("Replayed", games, "games in", t.s(), "seconds");
+    return sim;
+}
+
+//
+// ASYNC SIMULATION
+//
+
+AsyncSimulation::AsyncSimulation(int players, int iterations, int sp1, int sp2, int sp3, double sp4, const std::string &strategy_type, const SimulationOptions &options)
+{
+    progress = options.progress ? options.progress : std::make_shared<SimulationProgress>();
+    SimulationOptions opts = options;
+    opts.progress = progress;
+    m_thread = std::thread([=]()
+                           {
+                               try
+                               {
+                                   result = std::make_unique<Simulation>(run_sim(players, iterations, sp1, sp2, sp3, sp4, strategy_type, false, opts));
+                               }
+                               catch (...)
+                               {
+                                   error = std::current_exception();
+                                   progress->finished = true;
+                               }
+                           });
+}
+
+AsyncSimulation::~AsyncSimulation()
+{
+    cancel();
+    wait();
+}
+
+// Asks the simulation to stop. It will finish the current game and keep its data.
+void AsyncSimulation::cancel()
+{
+    progress->cancelled = true;
+}
+
+// Waits until the simulation thread finishes
+void AsyncSimulation::wait()
+{
+    if (m_thread.joinable())
+        m_thread.join();
+}
@@ -2,6 +2,36 @@
 
 #include "simulation.h"
 
+#include <exception>
 #include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
-Simulation run_sim(int players, int iterations, int sp1, int sp2, int sp3, double sp4, const std::string &strategy_type, bool gradual = false);
+std::unique_ptr<MatchmakingStrategy> make_strategy(int sp1, int sp2, int sp3, double sp4, const std::string &strategy_type);
+const std::vector<std::string> &builtin_strategies();
+bool is_builtin_strategy(const std::string &strategy_type);
+bool strategy_uses_sigma(const std::string &strategy_type);
+Simulation create_sim(long long total_games, int sp1, int sp2, int sp3, double sp4, const std::string &strategy_type, const SimulationOptions &options);
+Simulation run_sim(int players, int iterations, int sp1, int sp2, int sp3, double sp4, const std::string &strategy_type, bool gradual = false, const SimulationOptions &options = SimulationOptions());
+Simulation replay_sim(MatchLog &log, int sp1, int sp2, int sp3, double sp4, const std::string &strategy_type, const SimulationOptions &options);
+
+// Runs a simulation on its own thread. Progress can be watched (and the simulation cancelled) through `progress`.
+// The destructor cancels and joins the thread, so don't destroy a running simulation while holding the GIL
+// (its thread might be waiting for it in a Python callback).
+class AsyncSimulation
+{
+    std::thread m_thread;
+
+public:
+    std::shared_ptr<SimulationProgress> progress;
+    // Available after `wait()`
+    std::unique_ptr<Simulation> result;
+    // Set instead of `result` when the simulation thread threw
+    std::exception_ptr error;
+
+    AsyncSimulation(int players, int iterations, int sp1, int sp2, int sp3, double sp4, const std::string &strategy_type, const SimulationOptions &options);
+    ~AsyncSimulation();
+    void cancel();
+    void wait();
+};
@@ -0,0 +1,115 @@
+#include "match_log.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MatchLog::MatchLog(const std::string &path, MatchLogFormat format) : m_format(format)
+{
+#ifdef _WIN32
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (m_file == INVALID_HANDLE_VALUE)
+    {
+        m_file = nullptr;
+        error = "Failed to open " + path;
+        return;
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(m_file, &size);
+    m_size = static_cast<size_t>(size.QuadPart);
+    if (m_size == 0)
+        return;
+    m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (m_mapping)
+        m_data = static_cast<const char *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    m_file = open(path.c_str(), O_RDONLY);
+    if (m_file < 0)
+    {
+        error = "Failed to open " + path;
+        return;
+    }
+    struct stat info;
+    fstat(m_file, &info);
+    m_size = static_cast<size_t>(info.st_size);
+    if (m_size == 0)
+        return;
+    void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+    if (data != MAP_FAILED)
+    {
+        m_data = static_cast<const char *>(data);
+        // Pages are read once front to back, so the kernel can read ahead and drop them early
+        madvise(data, m_size, MADV_SEQUENTIAL);
+    }
+#endif
+    if (!m_data)
+    {
+        error = "Failed to map " + path;
+        m_size = 0;
+    }
+}
+
+MatchLog::~MatchLog()
+{
+#ifdef _WIN32
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping)
+        CloseHandle(m_mapping);
+    if (m_file)
+        CloseHandle(m_file);
+#else
+    if (m_data)
+        munmap(const_cast<char *>(m_data), m_size);
+    if (m_file >= 0)
+        close(m_file);
+#endif
+}
+
+long long MatchLog::count() const
+{
+    if (m_format == MatchLogFormat::binary)
+        return static_cast<long long>(m_size / sizeof(MatchRecord));
+
+    const size_t SAMPLE = 1 << 16;
+    size_t sample = std::min(m_size, SAMPLE);
+    long long lines = 0;
+    const char *pos = m_data;
+    const char *end = m_data + sample;
+    while (pos < end)
+    {
+        const char *newline = static_cast<const char *>(memchr(pos, '\n', end - pos));
+        lines++;
+        if (!newline)
+            break;
+        pos = newline + 1;
+    }
+    if (sample == m_size)
+        return lines;
+    return static_cast<long long>(static_cast<double>(m_size) / sample * lines);
+}
+
+// Parses an unsigned number into `value` and skips the following comma.
+// Returns false if the field is empty or missing (value is 0 then).
+bool MatchLog::parse_number(const char *&pos, const char *end, uint64_t &value)
+{
+    while (pos < end && *pos == ' ')
+        pos++;
+    const char *start = pos;
+    value = 0;
+    while (pos < end && static_cast<unsigned>(*pos - '0') < 10)
+        value = value * 10 + (*pos++ - '0');
+    bool found = pos != start;
+    while (pos < end && *pos == ' ')
+        pos++;
+    if (pos < end && *pos == ',')
+        pos++;
+    return found;
+}
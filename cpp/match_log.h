@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+//
+// MATCH LOG
+// Historical matches read straight from a memory-mapped file, so logs much larger than RAM can be replayed.
+// Binary logs are arrays of `MatchRecord` (16 B, little-endian, no header).
+// CSV logs have one match per line: `player1,player2,winner,timestamp` where winner is the id of the winning
+// player (timestamp is optional). A header line is skipped.
+//
+
+enum class MatchLogFormat
+{
+    binary,
+    csv
+};
+
+#pragma pack(push, 1)
+struct MatchRecord
+{
+    uint32_t winner;
+    uint32_t loser;
+    int64_t timestamp;
+};
+#pragma pack(pop)
+
+class MatchLog
+{
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+    MatchLogFormat m_format;
+#ifdef _WIN32
+    void *m_file = nullptr;
+    void *m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+
+    static bool parse_number(const char *&pos, const char *end, uint64_t &value);
+
+public:
+    // Set when the file couldn't be opened or mapped
+    std::string error;
+    // CSV lines that couldn't be parsed (skipped)
+    long long invalid_lines = 0;
+
+    MatchLog(const std::string &path, MatchLogFormat format);
+    ~MatchLog();
+    MatchLog(const MatchLog &) = delete;
+    MatchLog &operator=(const MatchLog &) = delete;
+
+    bool is_open() const { return error.empty(); }
+    // Number of matches. CSV logs are estimated from the average line length at the start of the file,
+    // so the file isn't read twice.
+    long long count() const;
+
+    // Calls `f(winner, loser, timestamp)` for each match in the log until it returns false
+    template <typename F>
+    void for_each(F f)
+    {
+        if (m_format == MatchLogFormat::binary)
+        {
+            const char *end = m_data + m_size / sizeof(MatchRecord) * sizeof(MatchRecord);
+            for (const char *pos = m_data; pos < end; pos += sizeof(MatchRecord))
+            {
+                MatchRecord record;
+                memcpy(&record, pos, sizeof(MatchRecord));
+                if (!f(record.winner, record.loser, record.timestamp))
+                    return;
+            }
+            return;
+        }
+
+        const char *pos = m_data;
+        const char *end = m_data + m_size;
+        while (pos < end)
+        {
+            // Header or anything else that doesn't start with a number
+            if (*pos < '0' || *pos > '9')
+            {
+                if (*pos != '\n' && *pos != '\r')
+                    invalid_lines += pos != m_data;
+                while (pos < end && *pos++ != '\n')
+                    ;
+                continue;
+            }
+
+            uint64_t player1, player2, winner, timestamp;
+            bool complete = parse_number(pos, end, player1) && parse_number(pos, end, player2) &&
+                            parse_number(pos, end, winner);
+            // Timestamp is optional (0 when missing)
+            if (complete)
+                parse_number(pos, end, timestamp);
+            while (pos < end && *pos++ != '\n')
+                ;
+
+            if (!complete)
+                invalid_lines++;
+            else if (winner == player1)
+            {
+                if (!f(static_cast<uint32_t>(player1), static_cast<uint32_t>(player2), static_cast<int64_t>(timestamp)))
+                    return;
+            }
+            else if (winner == player2)
+            {
+                if (!f(static_cast<uint32_t>(player2), static_cast<uint32_t>(player1), static_cast<int64_t>(timestamp)))
+                    return;
+            }
+            else
+                invalid_lines++;
+        }
+    }
+};
@@ -0,0 +1,101 @@
+#include "memory.h"
+#include "simulation.h"
+
+#include <algorithm>
+
+// Vectors grow by doubling, so on average they hold ~1.5× the space they need
+static const double GROWTH_SLACK = 1.5;
+// PlayerHistory object with its vectors (heap allocation of a tracked player without any games)
+static const double HISTORY_OVERHEAD = sizeof(PlayerHistory) + 16;
+
+// Bytes recorded per game in a player history
+static double history_bytes_per_game(HistoryEncoding encoding, bool track_sigma)
+{
+    if (encoding == HistoryEncoding::compact)
+        return sizeof(int32_t) + sizeof(int16_t) + sizeof(uint16_t) + (track_sigma ? sizeof(int16_t) : 0);
+    return 3 * sizeof(double) + (track_sigma ? sizeof(double) : 0);
+}
+
+static double tracked_players(long long players, const SimulationOptions &options)
+{
+    switch (options.tracking)
+    {
+    case TrackingPolicy::all:
+        return static_cast<double>(players);
+    case TrackingPolicy::sample:
+        return static_cast<double>(std::min<long long>(players, options.track_sample));
+    case TrackingPolicy::percentile:
+        return players * std::max(0.0, options.track_percentile_max - options.track_percentile_min) / 100;
+    default:
+        return 0;
+    }
+}
+
+// History bytes of one tracked player (each game has two players)
+static double history_bytes_per_player(long long players, long long games, bool track_sigma, const SimulationOptions &options)
+{
+    double recorded = 2.0 * games / std::max(1LL, players) / std::max(1, options.track_every);
+    return HISTORY_OVERHEAD + recorded * history_bytes_per_game(options.history_encoding, track_sigma) * GROWTH_SLACK;
+}
+
+MemoryUsage estimate_memory(long long players, long long games, bool track_sigma, const SimulationOptions &options)
+{
+    MemoryUsage usage;
+    // Players are allocated in one go (see Simulation::add_players, gradual runs reserve all of them up front)
+    usage.players = static_cast<double>(players) * sizeof(Player);
+    usage.skill_by_id = static_cast<double>(players) * sizeof(double);
+    usage.histories = tracked_players(players, options) * history_bytes_per_player(players, games, track_sigma, options);
+    if (options.record_raw)
+        usage.raw_metrics = (2.0 * games + games / 100.0) * sizeof(double) * GROWTH_SLACK;
+    if (options.aggregate_bins > 0)
+        usage.aggregates = (3.0 + options.percentile_groups + 1) * options.aggregate_bins * 3 * sizeof(double);
+    if (options.candidate_index)
+        usage.candidate_index = static_cast<double>(players) * (sizeof(double) + sizeof(int));
+    return usage;
+}
+
+bool fit_memory_budget(long long players, long long games, bool track_sigma, SimulationOptions &options, std::vector<std::string> &notes)
+{
+    double budget = static_cast<double>(options.memory_budget);
+    auto fits = [&]()
+    { return options.memory_budget <= 0 || estimate_memory(players, games, track_sigma, options).total() <= budget; };
+    if (fits())
+        return true;
+    if (options.memory_refuse)
+    {
+        notes.push_back("estimated memory exceeds the budget");
+        return false;
+    }
+
+    if (options.tracking != TrackingPolicy::none && options.history_encoding == HistoryEncoding::full)
+    {
+        options.history_encoding = HistoryEncoding::compact;
+        notes.push_back("compact history encoding");
+        if (fits())
+            return true;
+    }
+    if (options.tracking != TrackingPolicy::none)
+    {
+        // Largest sample that fits into what's left after everything else
+        SimulationOptions untracked = options;
+        untracked.tracking = TrackingPolicy::none;
+        double left = budget - estimate_memory(players, games, track_sigma, untracked).total();
+        long long sample = static_cast<long long>(std::max(0.0, left / history_bytes_per_player(players, games, track_sigma, options)));
+        sample = std::min<long long>(sample, static_cast<long long>(tracked_players(players, options)));
+        if (sample > 0)
+        {
+            options.tracking = TrackingPolicy::sample;
+            options.track_sample = static_cast<int>(sample);
+            notes.push_back("tracking a sample of " + std::to_string(sample) + " players");
+        }
+        else
+        {
+            options.tracking = TrackingPolicy::none;
+            notes.push_back("player histories not recorded");
+        }
+        if (fits())
+            return true;
+    }
+    notes.push_back("players and raw per-game vectors don't fit into the budget even without histories");
+    return false;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct SimulationOptions;
+
+//
+// MEMORY ACCOUNTING
+// Bytes used by the main structures of a simulation, either estimated up front (`estimate_memory`)
+// or measured after a run (`Simulation::memory_usage`). Vectors are counted by their capacity.
+//
+
+struct MemoryUsage
+{
+    double players = 0;
+    double skill_by_id = 0;
+    double histories = 0;
+    double raw_metrics = 0;
+    double aggregates = 0;
+    double candidate_index = 0;
+
+    double total() const { return players + skill_by_id + histories + raw_metrics + aggregates + candidate_index; }
+};
+
+// Estimates memory of a simulation with `players` players and `games` games
+MemoryUsage estimate_memory(long long players, long long games, bool track_sigma, const SimulationOptions &options);
+
+// Changes options so the estimate fits into `options.memory_budget`. In order until it fits:
+// compact histories, fewer tracked players (sample), no tracking. Raw per-game vectors are never dropped,
+// functions that record them return or read them, so they have to fit as they are.
+// With `options.memory_refuse` nothing is changed. Returns false if it doesn't fit.
+// Each change (or the reason for failing) is added to `notes`.
+bool fit_memory_budget(long long players, long long games, bool track_sigma, SimulationOptions &options, std::vector<std::string> &notes);
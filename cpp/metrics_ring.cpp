@@ -0,0 +1,85 @@
+#include "metrics_ring.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+MetricsRing::MetricsRing(const std::string &name, uint32_t capacity) : m_name(name)
+{
+    capacity = capacity > 0 ? capacity : 1;
+    m_size = sizeof(MetricsRingHeader) + static_cast<size_t>(capacity) * sizeof(MetricsRecord);
+    void *data = nullptr;
+#ifdef _WIN32
+    m_mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, static_cast<DWORD>(static_cast<uint64_t>(m_size) >> 32),
+                                   static_cast<DWORD>(m_size), name.c_str());
+    bool taken = m_mapping && GetLastError() == ERROR_ALREADY_EXISTS;
+    if (m_mapping && !taken)
+        data = MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, m_size);
+    else if (m_mapping)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+#else
+    // Same naming as Python's multiprocessing.shared_memory. An existing segment is never replaced,
+    // it might belong to another running simulation with a monitor attached.
+    std::string shm_name = "/" + name;
+    int fd = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    bool taken = fd < 0 && errno == EEXIST;
+    if (fd >= 0)
+    {
+        if (ftruncate(fd, m_size) == 0)
+        {
+            data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (data == MAP_FAILED)
+                data = nullptr;
+        }
+        close(fd);
+        if (!data)
+            shm_unlink(shm_name.c_str());
+    }
+#endif
+    if (taken)
+    {
+        exists = true;
+        error = "Shared memory " + name + " already exists. Another simulation may be publishing to it; "
+                "use a different name (or remove /dev/shm/" + name + " left by a crashed run).";
+        return;
+    }
+    if (!data)
+    {
+        error = "Failed to create shared memory " + name;
+        return;
+    }
+
+    m_header = static_cast<MetricsRingHeader *>(data);
+    m_records = reinterpret_cast<MetricsRecord *>(m_header + 1);
+    m_header->capacity = capacity;
+    m_header->record_size = sizeof(MetricsRecord);
+    m_header->written.store(0, std::memory_order_relaxed);
+    m_header->finished.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < capacity; i++)
+        m_records[i].sequence.store(0, std::memory_order_relaxed);
+    m_header->version = MetricsRingHeader::VERSION;
+    // Readers check magic last, so they don't see a half initialized header
+    std::atomic_thread_fence(std::memory_order_release);
+    m_header->magic = MetricsRingHeader::MAGIC;
+}
+
+MetricsRing::~MetricsRing()
+{
+    if (!m_header)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(m_header);
+    CloseHandle(m_mapping);
+#else
+    munmap(m_header, m_size);
+    shm_unlink(("/" + m_name).c_str());
+#endif
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+//
+// METRICS RING
+// Metric snapshots published into a named shared memory segment so an external process can watch a running
+// simulation (see metrics_monitor.py). There is a single writer (the simulation thread) and any number of readers.
+// The writer never waits: when readers fall behind, old records are overwritten.
+//
+// Layout: `MetricsRingHeader` followed by `capacity` `MetricsRecord`s. Record `n` is stored in slot `n % capacity`.
+// A slot's `sequence` is 0 while it's being written and `n + 1` once record `n` is complete, so a reader copies the
+// slot and keeps it only if `sequence` was `n + 1` both before and after copying.
+//
+
+struct MetricsRingHeader
+{
+    static constexpr uint32_t MAGIC = 0x4d495350; // "PSIM"
+    static constexpr uint32_t VERSION = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t record_size;
+    // Number of records written so far
+    std::atomic<uint64_t> written;
+    // Set when the simulation finished
+    std::atomic<uint32_t> finished;
+    uint32_t padding;
+};
+
+struct MetricsRecord
+{
+    // MMR at 0%, 10%, ..., 100% of the population
+    static constexpr int MMR_QUANTILES = 11;
+
+    std::atomic<uint64_t> sequence;
+    int64_t games_played;
+    double games_per_second;
+    double prediction_difference;
+    double match_accuracy;
+    double good_match_fraction;
+    double mmr_quantiles[MMR_QUANTILES];
+};
+
+static_assert(sizeof(MetricsRingHeader) == 32, "Header layout is read by metrics_monitor.py");
+static_assert(sizeof(MetricsRecord) == 136, "Record layout is read by metrics_monitor.py");
+
+class MetricsRing
+{
+    MetricsRingHeader *m_header = nullptr;
+    MetricsRecord *m_records = nullptr;
+    size_t m_size = 0;
+    std::string m_name;
+#ifdef _WIN32
+    void *m_mapping = nullptr;
+#endif
+
+public:
+    // Set when the shared memory couldn't be created
+    std::string error;
+    // Whether it failed because a segment with the name already exists
+    bool exists = false;
+
+    // Creates shared memory segment `name` with room for `capacity` records. Fails (sets `error`) if it already exists.
+    MetricsRing(const std::string &name, uint32_t capacity);
+    // Removes the segment name. Readers that already opened it can still read.
+    ~MetricsRing();
+    MetricsRing(const MetricsRing &) = delete;
+    MetricsRing &operator=(const MetricsRing &) = delete;
+
+    bool is_open() const { return m_header != nullptr; }
+
+    // Writes the next record. Only one thread may call this.
+    void push(const MetricsRecord &record)
+    {
+        uint64_t n = m_header->written.load(std::memory_order_relaxed);
+        MetricsRecord &slot = m_records[n % m_header->capacity];
+        slot.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.games_played = record.games_played;
+        slot.games_per_second = record.games_per_second;
+        slot.prediction_difference = record.prediction_difference;
+        slot.match_accuracy = record.match_accuracy;
+        slot.good_match_fraction = record.good_match_fraction;
+        for (int i = 0; i < MetricsRecord::MMR_QUANTILES; i++)
+            slot.mmr_quantiles[i] = record.mmr_quantiles[i];
+        slot.sequence.store(n + 1, std::memory_order_release);
+        m_header->written.store(n + 1, std::memory_order_release);
+    }
+
+    void finish() { m_header->finished.store(1, std::memory_order_release); }
+};
@@ -0,0 +1,192 @@
+#include "plugins.h"
+#include "main.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+//
+// PLUGIN STRATEGY
+//
+
+Plugin_strategy::Plugin_strategy(const psim_strategy *api, const std::vector<double> &params)
+{
+    m_api = api;
+    m_state = m_api->create(params.data());
+    std::cout << "Plugin strategy " << m_api->name << " (";
+    for (size_t i = 0; i < params.size(); i++)
+        std::cout << (i ? ", " : "") << params[i];
+    std::cout << ")\n";
+}
+
+Plugin_strategy::~Plugin_strategy()
+{
+    if (m_api->destroy)
+        m_api->destroy(m_state);
+}
+
+bool Plugin_strategy::good_match(Player &p1, Player &p2)
+{
+    psim_player c1 = to_c(p1);
+    psim_player c2 = to_c(p2);
+    return m_api->good_match(m_state, &c1, &c2) != 0;
+}
+
+double Plugin_strategy::update_mmr(Player &winner, Player &loser, double actual_chances)
+{
+    psim_player w = to_c(winner);
+    psim_player l = to_c(loser);
+    double Ew = m_api->predict(m_state, &w, &l);
+
+    winner.record_game(loser, Ew);
+    loser.record_game(winner, 1 - Ew);
+
+    m_api->update(m_state, &w, &l);
+    winner.mmr = static_cast<rating_t>(w.mmr);
+    winner.sigma = static_cast<rating_t>(w.sigma);
+    loser.mmr = static_cast<rating_t>(l.mmr);
+    loser.sigma = static_cast<rating_t>(l.sigma);
+
+    return std::abs(actual_chances - Ew);
+}
+
+// Uses the batched predicate if the plugin has one (one call per chunk instead of one per player)
+size_t Plugin_strategy::count_good_matches(Player &player, std::vector<Player> &players)
+{
+    if (!m_api->good_match_batch)
+        return MatchmakingStrategy::count_good_matches(player, players);
+
+    const size_t CHUNK = 4096;
+    psim_player c = to_c(player);
+    size_t good = 0;
+    for (size_t start = 0; start < players.size(); start += CHUNK)
+    {
+        m_candidates.clear();
+        for (size_t i = start; i < std::min(players.size(), start + CHUNK); i++)
+            if (&players[i] != &player)
+                m_candidates.push_back(to_c(players[i]));
+        m_results.resize(m_candidates.size());
+        m_api->good_match_batch(m_state, &c, m_candidates.data(), static_cast<uint32_t>(m_candidates.size()), m_results.data());
+        for (uint8_t r : m_results)
+            good += r != 0;
+    }
+    return good;
+}
+
+double Plugin_strategy::mmr_window()
+{
+    if (!m_api->mmr_window)
+        return MatchmakingStrategy::mmr_window();
+    return m_api->mmr_window(m_state);
+}
+
+//
+// STRATEGY REGISTRY
+//
+
+StrategyRegistry &StrategyRegistry::instance()
+{
+    static StrategyRegistry registry;
+    return registry;
+}
+
+std::vector<std::string> StrategyRegistry::load(const std::string &path, std::string &error)
+{
+#ifdef _WIN32
+    HMODULE library = LoadLibraryA(path.c_str());
+    if (!library)
+    {
+        error = "Failed to load " + path;
+        return {};
+    }
+    auto entry = reinterpret_cast<psim_plugin_entry>(GetProcAddress(library, PSIM_PLUGIN_ENTRY_NAME));
+    auto close_library = [library]()
+    { FreeLibrary(library); };
+#else
+    void *library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!library)
+    {
+        error = dlerror();
+        return {};
+    }
+    auto entry = reinterpret_cast<psim_plugin_entry>(dlsym(library, PSIM_PLUGIN_ENTRY_NAME));
+    auto close_library = [library]()
+    { dlclose(library); };
+#endif
+    // Libraries stay loaded only if their strategies are registered
+    if (!entry)
+    {
+        error = path + " doesn't export " PSIM_PLUGIN_ENTRY_NAME;
+        close_library();
+        return {};
+    }
+
+    uint32_t count = 0;
+    const psim_strategy *strategies = entry(&count);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Validate everything first, so a bad library doesn't register half of its strategies
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const psim_strategy &s = strategies[i];
+        std::string name = s.name ? s.name : "";
+        if (s.abi_version != PSIM_STRATEGY_ABI_VERSION)
+            error = "Strategy " + name + " was built for ABI version " + std::to_string(s.abi_version) +
+                    " (expected " + std::to_string(PSIM_STRATEGY_ABI_VERSION) + ")";
+        else if (name.empty() || !s.create || !s.good_match || !s.predict || !s.update || (s.param_count > 0 && !s.params))
+            error = "Strategy " + name + " is missing its name or required functions";
+        else if (is_builtin_strategy(name))
+            error = "Strategy " + name + " has the same name as a built-in strategy";
+        else if (m_strategies.count(name) && m_strategies[name] != &s)
+            error = "Strategy " + name + " is already loaded from another library";
+        if (!error.empty())
+        {
+            close_library();
+            return {};
+        }
+    }
+
+    std::vector<std::string> names;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        m_strategies[strategies[i].name] = &strategies[i];
+        names.push_back(strategies[i].name);
+    }
+    return names;
+}
+
+const psim_strategy *StrategyRegistry::find(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_strategies.find(name);
+    return it == m_strategies.end() ? nullptr : it->second;
+}
+
+std::vector<std::string> StrategyRegistry::names()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<std::string> out;
+    for (auto &it : m_strategies)
+        out.push_back(it.first);
+    return out;
+}
+
+std::unique_ptr<MatchmakingStrategy> StrategyRegistry::create(const std::string &name, int sp1, int sp2, int sp3, double sp4)
+{
+    const psim_strategy *api = find(name);
+    if (!api)
+        return nullptr;
+
+    std::vector<double> params;
+    const double sp[] = {static_cast<double>(sp1), static_cast<double>(sp2), static_cast<double>(sp3), sp4};
+    for (uint32_t i = 0; i < api->param_count; i++)
+    {
+        const psim_param &param = api->params[i];
+        double value = i < 4 && sp[i] != -1 ? sp[i] : param.default_value;
+        params.push_back(std::max(param.min_value, std::min(param.max_value, value)));
+    }
+    return std::make_unique<Plugin_strategy>(api, params);
+}
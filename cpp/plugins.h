@@ -0,0 +1,61 @@
+#pragma once
+
+#include "strategies.h"
+#include "psim_strategy.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//
+// PLUGIN STRATEGY
+// Adapts a strategy from a shared library (see psim_strategy.h) to MatchmakingStrategy
+//
+class Plugin_strategy : public MatchmakingStrategy
+{
+    const psim_strategy *m_api;
+    void *m_state;
+    // Reused buffers for batched good_match
+    std::vector<psim_player> m_candidates;
+    std::vector<uint8_t> m_results;
+
+    static psim_player to_c(const Player &p)
+    {
+        return psim_player{static_cast<double>(p.mmr), static_cast<double>(p.sigma), p.id, p.games_played};
+    }
+
+public:
+    Plugin_strategy(const psim_strategy *api, const std::vector<double> &params);
+    ~Plugin_strategy();
+    bool good_match(Player &p1, Player &p2);
+    double update_mmr(Player &winner, Player &loser, double actual_chances);
+    size_t count_good_matches(Player &player, std::vector<Player> &players) override;
+    bool uses_sigma() override { return m_api->uses_sigma != 0; }
+    double mmr_window() override;
+    double initial_mmr() override { return m_api->initial_mmr >= 0 ? m_api->initial_mmr : -1; }
+    double initial_sigma() override { return m_api->initial_sigma >= 0 ? m_api->initial_sigma : -1; }
+};
+
+//
+// STRATEGY REGISTRY
+// Strategies loaded from shared libraries by name. Libraries stay loaded until the process exits.
+//
+class StrategyRegistry
+{
+    std::mutex m_mutex;
+    std::map<std::string, const psim_strategy *> m_strategies;
+
+    StrategyRegistry(){};
+
+public:
+    static StrategyRegistry &instance();
+    // Loads strategies from a shared library. Returns their names, or sets `error` and returns nothing.
+    std::vector<std::string> load(const std::string &path, std::string &error);
+    // Returns the strategy API or nullptr
+    const psim_strategy *find(const std::string &name);
+    std::vector<std::string> names();
+    // Creates strategy with parameters sp1-sp4 (-1 → default). Returns nullptr if there is no such strategy.
+    std::unique_ptr<MatchmakingStrategy> create(const std::string &name, int sp1, int sp2, int sp3, double sp4);
+};
@@ -0,0 +1,91 @@
+/*
+ * Example strategy plugin. Same as the built-in ELO strategy, so results can be compared with it.
+ *
+ *   gcc -O2 -shared -fPIC -o elo_plugin.so cpp/plugins/elo_plugin.c -lm
+ *
+ *   psimulation.load_strategy_plugin("./elo_plugin.so")
+ *   psimulation.run_simulation(20000, 2000000, "plugin_elo", 7)
+ */
+#include "../psim_strategy.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+typedef struct elo_state
+{
+    double K;
+    double window;
+} elo_state;
+
+static const psim_param elo_params[] = {
+    {"K", "MMR change for a game with 0% predicted chance of winning", 7, 0, 1000},
+    {"window", "Largest MMR difference of a good match", 120, 0, 10000},
+};
+
+static void *elo_create(const double *params)
+{
+    elo_state *state = (elo_state *)malloc(sizeof(elo_state));
+    state->K = params[0];
+    state->window = params[1];
+    return state;
+}
+
+static void elo_destroy(void *state)
+{
+    free(state);
+}
+
+static int32_t elo_good_match(void *state, const psim_player *p1, const psim_player *p2)
+{
+    return fabs(p1->mmr - p2->mmr) < ((elo_state *)state)->window;
+}
+
+static void elo_good_match_batch(void *state, const psim_player *player, const psim_player *candidates, uint32_t count, uint8_t *out)
+{
+    double window = ((elo_state *)state)->window;
+    for (uint32_t i = 0; i < count; i++)
+        out[i] = fabs(player->mmr - candidates[i].mmr) < window;
+}
+
+static double elo_predict(void *state, const psim_player *p1, const psim_player *p2)
+{
+    return 1 / (1 + exp((p2->mmr - p1->mmr) / 173.718));
+}
+
+static void elo_update(void *state, psim_player *winner, psim_player *loser)
+{
+    double El = 1 - elo_predict(state, winner, loser);
+    winner->mmr += ((elo_state *)state)->K * El;
+    loser->mmr -= ((elo_state *)state)->K * El;
+}
+
+static double elo_mmr_window(void *state)
+{
+    return ((elo_state *)state)->window;
+}
+
+static const psim_strategy strategies[] = {
+    {
+        PSIM_STRATEGY_ABI_VERSION,
+        "plugin_elo",
+        "ELO with a fixed K and MMR window",
+        elo_params,
+        2,
+        0,
+        -1,
+        -1,
+        elo_create,
+        elo_destroy,
+        elo_good_match,
+        elo_good_match_batch,
+        elo_predict,
+        elo_update,
+        elo_mmr_window,
+    },
+};
+
+PSIM_EXPORT const psim_strategy *psim_plugin_strategies(uint32_t *count)
+{
+    *count = sizeof(strategies) / sizeof(strategies[0]);
+    return strategies;
+}
@@ -0,0 +1,168 @@
+#include "population.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+SkillDistribution::SkillDistribution(const std::vector<double> &edges, const std::vector<double> &counts)
+{
+    m_mean = 0;
+    m_stdev = 0;
+    double total = 0;
+    for (double count : counts)
+        total += count;
+    if (edges.size() != counts.size() + 1 || total <= 0)
+        return;
+
+    m_edges = edges;
+    m_cdf.push_back(0);
+    for (double count : counts)
+        m_cdf.push_back(m_cdf.back() + count / total);
+    m_cdf.back() = 1;
+}
+
+bool SkillDistribution::load_histogram(const std::string &path, std::string &error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = "Can't open skill histogram " + path;
+        return false;
+    }
+
+    std::vector<double> edges, counts;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line))
+    {
+        line_number++;
+        if (line.find_first_not_of(" \t\r") == std::string::npos || line[line.find_first_not_of(" \t\r")] == '#')
+            continue;
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream values(line);
+        double start, end, count;
+        if (!(values >> start >> end >> count) || end <= start || count < 0 || (!edges.empty() && start < edges.back()))
+        {
+            error = "Invalid skill histogram line " + std::to_string(line_number) + " in " + path;
+            return false;
+        }
+        if (edges.empty())
+            edges.push_back(start);
+        else if (start > edges.back())
+        {
+            // Gaps between bins are empty bins
+            edges.push_back(start);
+            counts.push_back(0);
+        }
+        edges.push_back(end);
+        counts.push_back(count);
+    }
+
+    SkillDistribution histogram(edges, counts);
+    if (!histogram.is_histogram())
+    {
+        error = "Skill histogram " + path + " has no players";
+        return false;
+    }
+    *this = histogram;
+    return true;
+}
+
+double SkillDistribution::percentile(double skill) const
+{
+    if (!is_histogram())
+        return 50 * (1 + erf((skill - m_mean) / m_stdev / sqrt(2)));
+    if (skill <= m_edges.front())
+        return 0;
+    if (skill >= m_edges.back())
+        return 100;
+    size_t bin = std::upper_bound(m_edges.begin(), m_edges.end(), skill) - m_edges.begin() - 1;
+    double inside = (skill - m_edges[bin]) / (m_edges[bin + 1] - m_edges[bin]);
+    return 100 * (m_cdf[bin] + inside * (m_cdf[bin + 1] - m_cdf[bin]));
+}
+
+void SkillDistribution::sample(std::mt19937_64 &rng, double *out, size_t count) const
+{
+    if (!is_histogram())
+    {
+        std::normal_distribution<> normal(m_mean, m_stdev);
+        for (size_t i = 0; i < count; i++)
+            out[i] = normal(rng);
+        return;
+    }
+    // Inverse of the piecewise linear CDF
+    std::uniform_real_distribution<> uniform(0, 1);
+    for (size_t i = 0; i < count; i++)
+    {
+        double u = uniform(rng);
+        size_t bin = std::upper_bound(m_cdf.begin(), m_cdf.end(), u) - m_cdf.begin() - 1;
+        bin = std::min(bin, m_edges.size() - 2);
+        double width = m_cdf[bin + 1] - m_cdf[bin];
+        double inside = width > 0 ? (u - m_cdf[bin]) / width : 0;
+        out[i] = m_edges[bin] + inside * (m_edges[bin + 1] - m_edges[bin]);
+    }
+}
+
+// Thread limit of `for_each_chunk` calls made from this thread (0 → hardware concurrency)
+static thread_local size_t chunk_threads = 0;
+
+void set_chunk_threads(size_t threads)
+{
+    chunk_threads = threads;
+}
+
+std::mt19937_64 chunk_engine(uint64_t seed, size_t chunk)
+{
+    std::seed_seq sequence{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32), static_cast<uint32_t>(chunk)};
+    return std::mt19937_64(sequence);
+}
+
+void for_each_chunk(size_t count, const std::function<void(size_t chunk, size_t begin, size_t end)> &f)
+{
+    size_t chunks = (count + POPULATION_CHUNK - 1) / POPULATION_CHUNK;
+    size_t available = chunk_threads > 0 ? chunk_threads : std::max(1u, std::thread::hardware_concurrency());
+    size_t threads = std::min(chunks, available);
+    if (threads <= 1)
+    {
+        for (size_t chunk = 0; chunk < chunks; chunk++)
+            f(chunk, chunk * POPULATION_CHUNK, std::min(count, (chunk + 1) * POPULATION_CHUNK));
+        return;
+    }
+
+    // Exceptions (e.g. bad_alloc) are kept per thread and the first one is rethrown after all threads are joined
+    std::vector<std::exception_ptr> errors(threads);
+    auto run = [&](size_t first_chunk)
+    {
+        try
+        {
+            for (size_t chunk = first_chunk; chunk < chunks; chunk += threads)
+                f(chunk, chunk * POPULATION_CHUNK, std::min(count, (chunk + 1) * POPULATION_CHUNK));
+        }
+        catch (...)
+        {
+            errors[first_chunk] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    try
+    {
+        for (size_t t = 1; t < threads; t++)
+            workers.emplace_back(run, t);
+    }
+    catch (...)
+    {
+        // Couldn't start a thread, its chunks are run here
+        for (size_t t = workers.size() + 1; t < threads; t++)
+            run(t);
+    }
+    run(0);
+    for (std::thread &worker : workers)
+        worker.join();
+    for (std::exception_ptr &error : errors)
+        if (error)
+            std::rethrow_exception(error);
+}
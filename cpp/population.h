@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+//
+// POPULATION
+// Skill distributions for new players and helpers for initializing large populations in parallel.
+// Players are generated in fixed-size chunks and every chunk has its own random stream seeded from
+// (population seed, chunk index), so a seeded population is the same for any number of threads.
+//
+
+// Players generated per chunk (and the smallest amount of work given to a thread)
+const size_t POPULATION_CHUNK = 1 << 16;
+
+class SkillDistribution
+{
+    double m_mean;
+    double m_stdev;
+    // Empirical histogram (empty → normal distribution). `m_cdf[i]` is the fraction of players below `m_edges[i]`.
+    std::vector<double> m_edges;
+    std::vector<double> m_cdf;
+
+public:
+    SkillDistribution(double mean = 2820 / 2.2, double stdev = 800 / 2.2) : m_mean(mean), m_stdev(stdev){};
+    // Histogram from bin edges (bins + 1 values) and player counts (bins values).
+    // Skills are spread uniformly inside each bin.
+    SkillDistribution(const std::vector<double> &edges, const std::vector<double> &counts);
+    // Loads a histogram from a text file with lines `bin_start,bin_end,count` (e.g. exported from a real ladder).
+    // Bins have to be sorted and must not overlap. Empty lines and lines starting with `#` are skipped.
+    // Returns false and sets `error` if the file can't be used.
+    bool load_histogram(const std::string &path, std::string &error);
+
+    bool is_histogram() const { return !m_edges.empty(); }
+    // Skill percentile (0-100)
+    double percentile(double skill) const;
+    // Writes `count` skills drawn from the distribution
+    void sample(std::mt19937_64 &rng, double *out, size_t count) const;
+};
+
+// Random stream of one chunk
+std::mt19937_64 chunk_engine(uint64_t seed, size_t chunk);
+
+// Calls `f(chunk, begin, end)` for consecutive chunks of `count` items. Chunks run in parallel when there are
+// several of them, so `f` may only touch items of its own chunk.
+void for_each_chunk(size_t count, const std::function<void(size_t chunk, size_t begin, size_t end)> &f);
+
+// Limits threads of `for_each_chunk` calls made from the calling thread (0 → hardware concurrency).
+// Simulations running side by side set it, so together they don't start more threads than there are cores.
+void set_chunk_threads(size_t threads);
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "mutils.h"
+#include "metrics_ring.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+
+//
+// SIMULATION PROGRESS
+// Shared between the thread running a simulation and whoever is watching it.
+// The simulation thread accumulates metrics locally and publishes a snapshot every `publish_every` games,
+// so the watcher never has to touch simulation data and the simulation never waits for the watcher.
+// Snapshots can also go to a shared memory ring (`open_ring`) for watchers in other processes.
+//
+
+// Metrics at some point of the simulation. Window values are averages over the last published window.
+struct MetricsSnapshot
+{
+    long long games_played = 0;
+    double games_per_second = 0;
+    double prediction_difference = 0;
+    double match_accuracy = 0;
+    double good_match_fraction = 0;
+    // MMR at 0%, 10%, ..., 100% of the population (set by the simulation)
+    std::array<double, MetricsRecord::MMR_QUANTILES> mmr_quantiles{};
+};
+
+class SimulationProgress
+{
+    std::chrono::steady_clock::time_point m_start = std::chrono::steady_clock::now();
+    mutable std::mutex m_mutex;
+    MetricsSnapshot m_snapshot;
+
+    // Only touched by the simulation thread
+    long long m_games = 0;
+    double m_pred_sum = 0;
+    double m_acc_sum = 0;
+    double m_fraction_sum = 0;
+    long long m_window_games = 0;
+    long long m_fraction_count = 0;
+    std::array<double, MetricsRecord::MMR_QUANTILES> m_mmr_quantiles{};
+    std::unique_ptr<MetricsRing> m_ring;
+
+    void publish()
+    {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+        MetricsSnapshot snapshot;
+        snapshot.games_played = m_games;
+        snapshot.games_per_second = seconds > 0 ? m_games / seconds : 0;
+        if (m_window_games > 0)
+        {
+            snapshot.prediction_difference = m_pred_sum / m_window_games;
+            snapshot.match_accuracy = m_acc_sum / m_window_games;
+        }
+        if (m_fraction_count > 0)
+            snapshot.good_match_fraction = m_fraction_sum / m_fraction_count;
+        snapshot.mmr_quantiles = m_mmr_quantiles;
+
+        if (m_ring)
+        {
+            MetricsRecord record;
+            record.games_played = snapshot.games_played;
+            record.games_per_second = snapshot.games_per_second;
+            record.prediction_difference = snapshot.prediction_difference;
+            record.match_accuracy = snapshot.match_accuracy;
+            record.good_match_fraction = snapshot.good_match_fraction;
+            std::copy(m_mmr_quantiles.begin(), m_mmr_quantiles.end(), record.mmr_quantiles);
+            m_ring->push(record);
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_snapshot = snapshot;
+        }
+        games_played.store(m_games, std::memory_order_relaxed);
+
+        m_pred_sum = m_acc_sum = m_fraction_sum = 0;
+        m_window_games = m_fraction_count = 0;
+    }
+
+public:
+    std::atomic<long long> games_played{0};
+    std::atomic<long long> target_games{0};
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> finished{false};
+    long long publish_every = 10000;
+
+    // Publishes snapshots into shared memory segment `name` as well. Returns the error if it couldn't be created
+    // (`exists` is set if the name is taken).
+    std::string open_ring(const std::string &name, uint32_t capacity, bool *exists = nullptr)
+    {
+        m_ring = std::make_unique<MetricsRing>(name, capacity);
+        if (m_ring->is_open())
+            return "";
+        std::string error = m_ring->error;
+        if (exists)
+            *exists = m_ring->exists;
+        m_ring.reset();
+        return error;
+    }
+
+    bool has_ring() const { return m_ring != nullptr; }
+
+    // Whether the next `add_game` publishes a snapshot (time to update MMR quantiles)
+    bool publish_due() const { return m_window_games + 1 >= publish_every; }
+
+    void set_mmr_quantiles(const std::array<double, MetricsRecord::MMR_QUANTILES> &quantiles) { m_mmr_quantiles = quantiles; }
+
+    void add_game(double pred_diff, double match_acc)
+    {
+        m_games++;
+        m_window_games++;
+        m_pred_sum += pred_diff;
+        m_acc_sum += match_acc;
+        if (m_window_games >= publish_every)
+            publish();
+    }
+
+    void add_good_match_fraction(double fraction)
+    {
+        m_fraction_sum += fraction;
+        m_fraction_count++;
+    }
+
+    // Publishes whatever is left in the last window (if anything) and marks the simulation as finished
+    void finish()
+    {
+        if (m_window_games > 0 || m_games == 0)
+            publish();
+        if (m_ring)
+            m_ring->finish();
+        finished = true;
+    }
+
+    MetricsSnapshot snapshot() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_snapshot;
+    }
+
+    double elapsed_seconds() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    }
+};
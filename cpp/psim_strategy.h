@@ -0,0 +1,83 @@
+/*
+ * STRATEGY PLUGIN ABI
+ * Plain C interface for matchmaking strategies compiled into shared libraries and loaded at runtime with
+ * `psimulation.load_strategy_plugin(path)`. Include only this header, export `psim_plugin_strategies` and build
+ * with e.g. `gcc -O2 -shared -fPIC -o my_strategy.so my_strategy.c` (see cpp/plugins/elo_plugin.c).
+ *
+ * The engine calls `predict` before `update` for every game, so player histories get the predicted chance
+ * and prediction difference is computed the same way as for built-in strategies.
+ * All functions are called from the simulation thread only. One `state` is created per simulation.
+ */
+#ifndef PSIM_STRATEGY_H
+#define PSIM_STRATEGY_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define PSIM_STRATEGY_ABI_VERSION 1
+
+#ifdef _WIN32
+#define PSIM_EXPORT __declspec(dllexport)
+#else
+#define PSIM_EXPORT __attribute__((visibility("default")))
+#endif
+
+    /* What a strategy sees of a player. `update` writes new `mmr` and `sigma`. */
+    typedef struct psim_player
+    {
+        double mmr;
+        double sigma;
+        int32_t id;
+        int32_t games_played;
+    } psim_player;
+
+    /* One strategy parameter. Simulation parameters sp1-sp4 set the first four (-1 keeps the default).
+       Values are clamped to min_value - max_value. */
+    typedef struct psim_param
+    {
+        const char *name;
+        const char *description;
+        double default_value;
+        double min_value;
+        double max_value;
+    } psim_param;
+
+    typedef struct psim_strategy
+    {
+        uint32_t abi_version; /* PSIM_STRATEGY_ABI_VERSION */
+        const char *name;
+        const char *description;
+        const psim_param *params;
+        uint32_t param_count;
+        int32_t uses_sigma;   /* save sigma into player histories */
+        double initial_mmr;   /* < 0 → engine default */
+        double initial_sigma; /* < 0 → engine default */
+
+        /* Creates strategy state. `params` has `param_count` values. */
+        void *(*create)(const double *params);
+        void (*destroy)(void *state);
+        /* Non-zero if the match between p1 and p2 is good */
+        int32_t (*good_match)(void *state, const psim_player *p1, const psim_player *p2);
+        /* Optional (may be NULL): out[i] = good_match(player, candidates[i]) for `count` candidates */
+        void (*good_match_batch)(void *state, const psim_player *player, const psim_player *candidates, uint32_t count, uint8_t *out);
+        /* Chance of p1 winning against p2 as predicted by the strategy */
+        double (*predict)(void *state, const psim_player *p1, const psim_player *p2);
+        /* Updates ratings after the game */
+        void (*update)(void *state, psim_player *winner, psim_player *loser);
+        /* Optional (may be NULL): largest MMR difference `good_match` can accept */
+        double (*mmr_window)(void *state);
+    } psim_strategy;
+
+    /* Entry point exported by the plugin. Returns an array of `*count` strategies that live as long as the library. */
+    typedef const psim_strategy *(*psim_plugin_entry)(uint32_t *count);
+#define PSIM_PLUGIN_ENTRY_NAME "psim_plugin_strategies"
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
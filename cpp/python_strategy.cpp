@@ -0,0 +1,233 @@
+#define PY_SSIZE_T_CLEAN
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+// NumPy API is initialized in sim.cpp
+#define PY_ARRAY_UNIQUE_SYMBOL psimulation_ARRAY_API
+#define NO_IMPORT_ARRAY
+#include "python_strategy.h"
+#include <numpy/arrayobject.h>
+
+#include <stdexcept>
+#include <string>
+
+BatchStrategyConfig batch_strategy_config;
+
+// Sets the Python function and settings used by the "python_batch" strategy
+// set_batch_strategy(rate, *, prediction="gaussian", scale=25/6, max_chance_difference=0.17, mmr_window=inf,
+//                    initial_mmr=25, initial_sigma=25/3, uses_sigma=True, batch_size=1024)
+PyObject *set_batch_strategy(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char *kwlist[] = {"rate", "prediction", "scale", "max_chance_difference", "mmr_window",
+                                   "initial_mmr", "initial_sigma", "uses_sigma", "batch_size", NULL};
+    BatchStrategyConfig config;
+    const char *prediction = "gaussian";
+    int uses_sigma = config.uses_sigma;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|$sdddddpi", const_cast<char **>(kwlist), &config.rate, &prediction, &config.scale,
+                                     &config.max_chance_difference, &config.mmr_window, &config.initial_mmr, &config.initial_sigma,
+                                     &uses_sigma, &config.batch_size))
+        return NULL;
+    if (!PyCallable_Check(config.rate))
+    {
+        PyErr_SetString(PyExc_TypeError, "rate must be callable");
+        return NULL;
+    }
+    const std::string prediction_type = prediction;
+    if (prediction_type == "gaussian")
+        config.prediction = BatchPrediction::gaussian;
+    else if (prediction_type == "logistic")
+        config.prediction = BatchPrediction::logistic;
+    else
+    {
+        PyErr_SetString(PyExc_ValueError, "prediction must be gaussian or logistic");
+        return NULL;
+    }
+    if (config.batch_size < 1 || config.scale <= 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "batch_size and scale must be positive");
+        return NULL;
+    }
+    config.uses_sigma = uses_sigma;
+
+    Py_INCREF(config.rate);
+    Py_XDECREF(batch_strategy_config.rate);
+    batch_strategy_config = config;
+    Py_RETURN_NONE;
+}
+
+//
+// PYTHON BATCH STRATEGY
+//
+
+Python_batch_strategy::Python_batch_strategy(const BatchStrategyConfig &config)
+{
+    m_config = config;
+    // Keep the function alive even if it's replaced while this strategy runs
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    Py_XINCREF(m_config.rate);
+    PyGILState_Release(gstate);
+    std::cout << "PYTHON BATCH strategy (batch size " << m_config.batch_size << ")\n";
+}
+
+Python_batch_strategy::~Python_batch_strategy()
+{
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    Py_XDECREF(m_config.rate);
+    PyGILState_Release(gstate);
+    if (m_batches > 0)
+        print("Python batch strategy:", m_games, "games in", m_batches, "batches");
+}
+
+double Python_batch_strategy::predict(Player &p1, Player &p2)
+{
+    double diff = p1.mmr - p2.mmr;
+    if (m_config.prediction == BatchPrediction::logistic)
+        return 1 / (1 + exp(-diff / m_config.scale));
+    double sigma = sqrt(p1.sigma * p1.sigma + p2.sigma * p2.sigma + 2 * m_config.scale * m_config.scale);
+    return 0.5 * erfc(-diff / (sigma * sqrt(2)));
+}
+
+bool Python_batch_strategy::good_match(Player &p1, Player &p2)
+{
+    return std::abs(p1.mmr - p2.mmr) < m_config.mmr_window && std::abs(predict(p1, p2) - 0.5) < m_config.max_chance_difference;
+}
+
+void Python_batch_strategy::set_pending(const Player &p, char value)
+{
+    if (p.id >= static_cast<int>(m_pending.size()))
+        m_pending.resize(std::max<size_t>(p.id + 1, m_pending.size() * 2), 0);
+    m_pending[p.id] = value;
+}
+
+double Python_batch_strategy::update_mmr(Player &winner, Player &loser, double actual_chances)
+{
+    if (is_pending(winner) || is_pending(loser))
+        flush();
+
+    double Ew = predict(winner, loser);
+    winner.record_game(loser, Ew);
+    loser.record_game(winner, 1 - Ew);
+
+    m_winners.push_back(winner.id);
+    m_losers.push_back(loser.id);
+    set_pending(winner, 1);
+    set_pending(loser, 1);
+
+    return std::abs(actual_chances - Ew);
+}
+
+void Python_batch_strategy::game_finished(std::vector<Player> &players)
+{
+    m_players = &players;
+    if (static_cast<int>(m_winners.size()) >= m_config.batch_size)
+        flush();
+}
+
+// Players can be removed between `play_games` calls, so nothing can stay pending after it
+void Python_batch_strategy::games_finished(std::vector<Player> &players)
+{
+    m_players = &players;
+    flush();
+}
+
+// Players are ordered by id without gaps (they are only removed from the start)
+Player &Python_batch_strategy::player(int id)
+{
+    std::vector<Player> &players = *m_players;
+    return players[id - players.front().id];
+}
+
+// Describes why a batch of `n` games wasn't rated and clears the Python exception (GIL has to be held)
+static std::string batch_error(npy_intp n)
+{
+    std::string error = "batch rate function has to return 4 arrays with " + std::to_string(n) + " values";
+    if (!PyErr_Occurred())
+        return error;
+    PyObject *type, *value, *traceback;
+    PyErr_Fetch(&type, &value, &traceback);
+    PyErr_NormalizeException(&type, &value, &traceback);
+    PyObject *text = value ? PyObject_Str(value) : NULL;
+    const char *message = text ? PyUnicode_AsUTF8(text) : NULL;
+    error = std::string("batch rate function raised ") + reinterpret_cast<PyTypeObject *>(type)->tp_name;
+    if (message && *message)
+        error += std::string(": ") + message;
+    Py_XDECREF(text);
+    Py_XDECREF(type);
+    Py_XDECREF(value);
+    Py_XDECREF(traceback);
+    PyErr_Clear();
+    return error;
+}
+
+// Sends pending games to Python and applies new ratings
+void Python_batch_strategy::flush()
+{
+    if (m_winners.empty())
+        return;
+
+    npy_intp n = static_cast<npy_intp>(m_winners.size());
+    PyGILState_STATE gstate = PyGILState_Ensure();
+
+    PyObject *arrays[4];
+    for (int i = 0; i < 4; i++)
+        arrays[i] = PyArray_SimpleNew(1, &n, NPY_DOUBLE);
+    double *winner_mu = static_cast<double *>(PyArray_DATA(reinterpret_cast<PyArrayObject *>(arrays[0])));
+    double *winner_sigma = static_cast<double *>(PyArray_DATA(reinterpret_cast<PyArrayObject *>(arrays[1])));
+    double *loser_mu = static_cast<double *>(PyArray_DATA(reinterpret_cast<PyArrayObject *>(arrays[2])));
+    double *loser_sigma = static_cast<double *>(PyArray_DATA(reinterpret_cast<PyArrayObject *>(arrays[3])));
+    for (npy_intp i = 0; i < n; i++)
+    {
+        winner_mu[i] = player(m_winners[i]).mmr;
+        winner_sigma[i] = player(m_winners[i]).sigma;
+        loser_mu[i] = player(m_losers[i]).mmr;
+        loser_sigma[i] = player(m_losers[i]).sigma;
+    }
+
+    PyObject *result = PyObject_CallFunctionObjArgs(m_config.rate, arrays[0], arrays[1], arrays[2], arrays[3], NULL);
+    for (PyObject *array : arrays)
+        Py_DECREF(array);
+
+    // Result has to be a sequence of 4 arrays with one value per game. Otherwise the simulation stops.
+    PyObject *values[4] = {NULL, NULL, NULL, NULL};
+    bool valid = result && PySequence_Check(result) && PySequence_Size(result) == 4;
+    for (int i = 0; valid && i < 4; i++)
+    {
+        PyObject *item = PySequence_GetItem(result, i);
+        values[i] = item ? PyArray_FROM_OTF(item, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY) : NULL;
+        Py_XDECREF(item);
+        valid = values[i] && PyArray_SIZE(reinterpret_cast<PyArrayObject *>(values[i])) == n;
+    }
+    if (valid)
+    {
+        const double *new_values[4];
+        for (int i = 0; i < 4; i++)
+            new_values[i] = static_cast<const double *>(PyArray_DATA(reinterpret_cast<PyArrayObject *>(values[i])));
+        for (npy_intp i = 0; i < n; i++)
+        {
+            Player &winner = player(m_winners[i]);
+            Player &loser = player(m_losers[i]);
+            winner.mmr = static_cast<rating_t>(new_values[0][i]);
+            winner.sigma = static_cast<rating_t>(new_values[1][i]);
+            loser.mmr = static_cast<rating_t>(new_values[2][i]);
+            loser.sigma = static_cast<rating_t>(new_values[3][i]);
+        }
+    }
+    std::string error;
+    if (!valid)
+        error = batch_error(n);
+    for (PyObject *value : values)
+        Py_XDECREF(value);
+    Py_XDECREF(result);
+    PyGILState_Release(gstate);
+    // Results of a broken rate function are meaningless, the entry point raises this
+    if (!error.empty())
+        throw std::runtime_error(error);
+
+    for (npy_intp i = 0; i < n; i++)
+    {
+        m_pending[m_winners[i]] = 0;
+        m_pending[m_losers[i]] = 0;
+    }
+    m_winners.clear();
+    m_losers.clear();
+    m_batches++;
+    m_games += n;
+}
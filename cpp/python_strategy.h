@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Python.h"
+#include "strategies.h"
+
+#include <limits>
+#include <vector>
+
+//
+// PYTHON BATCH STRATEGY
+// Rating updates are done by a Python function, but instead of calling it for every game (like Trueskill_strategy)
+// games are collected into a batch and the function gets NumPy arrays:
+//     rate(winner_mu, winner_sigma, loser_mu, loser_sigma) → (winner_mu, winner_sigma, loser_mu, loser_sigma)
+// A player is in at most one pending game, so every game is rated from the player's up-to-date rating. The batch is
+// sent when the next game has a pending player, when it's full, and at the end of `play_games`. If the function raises
+// or returns anything else, the simulation stops and the Python entry point raises RuntimeError.
+// Pending games keep player ids, not pointers: replay adds players while a batch is pending, which can reallocate them.
+// Until then pending players are matched with their pre-game ratings (as if the game was still in progress).
+// Predictions and good matches are computed natively from mu/sigma (see `BatchStrategyConfig`).
+//
+
+enum class BatchPrediction
+{
+    gaussian, // Φ((mu1 - mu2) / sqrt(sigma1² + sigma2² + 2 × scale²))  (Trueskill)
+    logistic  // 1 / (1 + exp(-(mu1 - mu2) / scale))                     (ELO)
+};
+
+// Set from Python with `set_batch_strategy`
+struct BatchStrategyConfig
+{
+    PyObject *rate = nullptr;
+    BatchPrediction prediction = BatchPrediction::gaussian;
+    double scale = 25. / 6;
+    // Good match: predicted chance within 50% ± max_chance_difference and MMR difference below mmr_window
+    double max_chance_difference = 0.17;
+    double mmr_window = std::numeric_limits<double>::infinity();
+    // Defaults are on the Trueskill scale. Negative values → engine defaults.
+    double initial_mmr = 25.;
+    double initial_sigma = 25. / 3;
+    bool uses_sigma = true;
+    int batch_size = 1024;
+};
+
+extern BatchStrategyConfig batch_strategy_config;
+
+PyObject *set_batch_strategy(PyObject *self, PyObject *args, PyObject *kwargs);
+
+class Python_batch_strategy : public MatchmakingStrategy
+{
+    BatchStrategyConfig m_config;
+    // Ids of pending players
+    std::vector<int> m_winners;
+    std::vector<int> m_losers;
+    // Simulation players, set by `game_finished` (before anything can be pending)
+    std::vector<Player> *m_players = nullptr;
+    // Whether a player (by id) is in the pending batch
+    std::vector<char> m_pending;
+    long long m_batches = 0;
+    long long m_games = 0;
+
+    bool is_pending(const Player &p) const { return p.id < static_cast<int>(m_pending.size()) && m_pending[p.id]; }
+    void set_pending(const Player &p, char value);
+    Player &player(int id);
+    void flush();
+
+public:
+    Python_batch_strategy(const BatchStrategyConfig &config);
+    ~Python_batch_strategy();
+    double predict(Player &p1, Player &p2);
+    bool good_match(Player &p1, Player &p2);
+    double update_mmr(Player &winner, Player &loser, double actual_chances);
+    void game_finished(std::vector<Player> &players) override;
+    void games_finished(std::vector<Player> &players) override;
+    bool uses_sigma() override { return m_config.uses_sigma; }
+    double mmr_window() override { return m_config.mmr_window; }
+    long long rating_updates() override { return m_batches; }
+    double initial_mmr() override { return m_config.initial_mmr; }
+    double initial_sigma() override { return m_config.initial_sigma; }
+};
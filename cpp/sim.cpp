@@ -1,78 +1,422 @@
 #define PY_SSIZE_T_CLEAN
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSIO
+// NumPy API is shared with python_strategy.cpp
+#define PY_ARRAY_UNIQUE_SYMBOL psimulation_ARRAY_API
+#include <exception>
 #include <future>
+#include <algorithm>
+#include <map>
 #include <Python.h>
 #include <numpy/arrayobject.h>
 #include "main.h"
 #include "mutils.h"
 #include "trueskill.h"
+#include "plugins.h"
+#include "python_strategy.h"
 
 static char module_docstring[] =
     "Module simulating various strategies for matchmaking";
 
+// Creates a numpy array from a vector of doubles
+PyObject *get_np_array(std::vector<double> vect)
+{
+    double *carray = new double[vect.size()];
+    std::copy(vect.begin(), vect.end(), carray);
+    npy_intp m = vect.size();
+    return PyArray_SimpleNewFromData(1, &m, NPY_DOUBLE, carray);
+}
+
+// Creates a numpy array from a vector reference of doubles
+// Uses less memory as there is no data copy, but we need to make sure the owner of the vector loses its pointer
+PyObject *get_np_array_from_pointer(std::vector<double> *vect)
+{
+    double *carray = vect->data();
+    npy_intp m = vect->size();
+    return PyArray_SimpleNewFromData(1, &m, NPY_DOUBLE, carray);
+}
+
+// Creates a numpy array that owns a copy of the data. Use for small arrays.
+PyObject *get_np_array_copy(const std::vector<double> &vect, int rows = 1)
+{
+    npy_intp dims[2] = {rows, static_cast<npy_intp>(vect.size()) / rows};
+    PyObject *array = rows > 1 ? PyArray_SimpleNew(2, dims, NPY_DOUBLE) : PyArray_SimpleNew(1, &dims[1], NPY_DOUBLE);
+    std::copy(vect.begin(), vect.end(), static_cast<double *>(PyArray_DATA(reinterpret_cast<PyArrayObject *>(array))));
+    return array;
+}
+
+// Adds a numpy array to a dictionary (and drops our reference to it)
+void set_dict_array(PyObject *dict, const char *key, PyObject *array)
+{
+    PyDict_SetItemString(dict, key, array);
+    Py_DECREF(array);
+}
+
+// Creates a dictionary with bytes used by each structure
+PyObject *get_memory_dict(const MemoryUsage &usage)
+{
+    return Py_BuildValue("{sdsdsdsdsdsdsd}",
+                         "players", usage.players,
+                         "skill_by_id", usage.skill_by_id,
+                         "histories", usage.histories,
+                         "raw_metrics", usage.raw_metrics,
+                         "aggregates", usage.aggregates,
+                         "candidate_index", usage.candidate_index,
+                         "total", usage.total());
+}
+
+// Creates a dictionary with the convergence point and values at each check
+PyObject *get_convergence_dict(const ConvergenceCheck &convergence, long long games_played)
+{
+    PyObject *Result = Py_BuildValue("{sOsLsL}",
+                                     "converged", convergence.converged() ? Py_True : Py_False,
+                                     "games", convergence.converged_at,
+                                     "games_played", games_played);
+    set_dict_array(Result, "checks", get_np_array_copy(convergence.games));
+    set_dict_array(Result, "prediction_difference", get_np_array_copy(convergence.prediction_difference));
+    set_dict_array(Result, "rank_correlation", get_np_array_copy(convergence.rank_correlation));
+    set_dict_array(Result, "median_sigma", get_np_array_copy(convergence.median_sigma));
+    return Result;
+}
+
+// Adds binned prediction difference, match accuracy and good match fraction to a dictionary
+void set_binned_series(PyObject *Result, Aggregates &ag)
+{
+    set_dict_array(Result, "bin_start", get_np_array_copy(ag.bin_starts()));
+    set_dict_array(Result, "prediction_difference_mean", get_np_array_copy(ag.prediction_difference.means()));
+    set_dict_array(Result, "prediction_difference_std", get_np_array_copy(ag.prediction_difference.stdevs()));
+    set_dict_array(Result, "match_accuracy_mean", get_np_array_copy(ag.match_accuracy.means()));
+    set_dict_array(Result, "match_accuracy_std", get_np_array_copy(ag.match_accuracy.stdevs()));
+    set_dict_array(Result, "good_match_fraction_mean", get_np_array_copy(ag.good_match_fraction.means()));
+
+    // Sums are what the scripts report as the overall score
+    PyObject *value = PyFloat_FromDouble(ag.prediction_difference.total());
+    PyDict_SetItemString(Result, "prediction_difference_sum", value);
+    Py_DECREF(value);
+    value = PyFloat_FromDouble(ag.match_accuracy.total());
+    PyDict_SetItemString(Result, "match_accuracy_sum", value);
+    Py_DECREF(value);
+}
+
+// Creates a dictionary with aggregates computed during the simulation and histograms of the final population
+PyObject *get_aggregates(Simulation &sim, int hist_bins)
+{
+    PyObject *Result = PyDict_New();
+    Aggregates &ag = *sim.aggregates;
+    set_binned_series(Result, ag);
+
+    PyObject *memory = get_memory_dict(sim.memory_usage());
+    PyDict_SetItemString(Result, "memory", memory);
+    Py_DECREF(memory);
+    if (sim.convergence)
+    {
+        PyObject *convergence = get_convergence_dict(*sim.convergence, sim.total_games_played);
+        PyDict_SetItemString(Result, "convergence", convergence);
+        Py_DECREF(convergence);
+    }
+
+    // Prediction difference over games for each skill percentile group
+    std::vector<double> convergence;
+    for (BinnedSeries &series : ag.percentile_convergence)
+    {
+        std::vector<double> means = series.means();
+        convergence.insert(convergence.end(), means.begin(), means.end());
+    }
+    set_dict_array(Result, "percentile_convergence", get_np_array_copy(convergence, ag.percentile_groups()));
+
+    // Latency cost of matches and how it relates to match quality
+    if (ag.has_latency)
+    {
+        set_dict_array(Result, "latency_mean", get_np_array_copy(ag.latency.means()));
+        set_dict_array(Result, "latency_std", get_np_array_copy(ag.latency.stdevs()));
+        set_dict_array(Result, "latency_bin_start", get_np_array_copy(ag.latency_bin_starts()));
+        set_dict_array(Result, "match_accuracy_by_latency", get_np_array_copy(ag.match_accuracy_by_latency.means()));
+        std::vector<double> counts(ag.match_accuracy_by_latency.count.begin(), ag.match_accuracy_by_latency.count.end());
+        set_dict_array(Result, "games_by_latency", get_np_array_copy(counts));
+    }
+
+    // Final population sorted by skill
+    std::vector<Player *> sorted;
+    for (Player &p : sim.players)
+        sorted.push_back(&p);
+    std::sort(sorted.begin(), sorted.end(), [](Player *a, Player *b) { return a->skill < b->skill; });
+    std::vector<double> skills, mmrs, games;
+    for (Player *p : sorted)
+    {
+        skills.push_back(p->skill);
+        mmrs.push_back(p->mmr);
+        games.push_back(p->games_played);
+    }
+    set_dict_array(Result, "skill", get_np_array_copy(skills));
+    set_dict_array(Result, "mmr", get_np_array_copy(mmrs));
+
+    Histogram mmr_skill(skills, mmrs, hist_bins, hist_bins);
+    set_dict_array(Result, "mmr_skill_hist", get_np_array_copy(mmr_skill.counts, hist_bins));
+    set_dict_array(Result, "mmr_skill_hist_skill_edges", get_np_array_copy(mmr_skill.x_edges));
+    set_dict_array(Result, "mmr_skill_hist_mmr_edges", get_np_array_copy(mmr_skill.y_edges));
+
+    Histogram games_played(games, hist_bins);
+    set_dict_array(Result, "games_played_hist", get_np_array_copy(games_played.counts));
+    set_dict_array(Result, "games_played_edges", get_np_array_copy(games_played.x_edges));
+    return Result;
+}
+
 // Helper function that creates a dictionary of all player data
-PyObject *get_player_data(Player &p)
-{
-    // Create numpy objects
-    npy_intp m = p.opponent_history->size();
-    PyObject *opponent_history = PyArray_SimpleNewFromData(1, &m, NPY_DOUBLE, &((*p.opponent_history)[0]));
-    PyObject *mmr_history = PyArray_SimpleNewFromData(1, &m, NPY_DOUBLE, &((*p.mmr_history)[0]));
-    PyObject *predicted_chances = PyArray_SimpleNewFromData(1, &m, NPY_DOUBLE, &((*p.predicted_chances)[0]));
-    PyObject *sigma_history = PyArray_SimpleNewFromData(1, &m, NPY_DOUBLE, &((*p.sigma_history)[0]));
-    // release unique_ptrs so they won't delete data
-    p.opponent_history.release();
-    p.mmr_history.release();
-    p.predicted_chances.release();
-    p.sigma_history.release();
+PyObject *get_player_data(Player &p, const std::vector<double> &skill_by_id)
+{
+    // Histories are decoded (if compact) and handed over to numpy arrays. Untracked players get empty arrays.
+    // Release unique_ptrs so they won't delete data
+    PlayerHistory empty;
+    PlayerHistory &history = p.history ? *p.history : empty;
+    size_t games = history.size();
+    PyObject *sigma_history = get_np_array_from_pointer(history.take_sigma_history(games).release());
+    PyObject *opponent_history = get_np_array_from_pointer(history.take_opponent_history(skill_by_id).release());
+    PyObject *mmr_history = get_np_array_from_pointer(history.take_mmr_history().release());
+    PyObject *predicted_chances = get_np_array_from_pointer(history.take_predicted_chances().release());
 
     // Build a final player object
-    return Py_BuildValue("{sdsdsdsOsOsOsO}", "skill", p.skill, "mmr", p.mmr, "sigma", p.sigma, "opponent_history", opponent_history, "mmr_history", mmr_history, "predicted_chances", predicted_chances, "sigma_history", sigma_history);
+    return Py_BuildValue("{sdsdsdsisisOsOsOsO}", "skill", p.skill, "mmr", p.mmr, "sigma", p.sigma, "games_played", p.games_played, "region", p.region, "opponent_history", opponent_history, "mmr_history", mmr_history, "predicted_chances", predicted_chances, "sigma_history", sigma_history);
 }
 
-// Initialize and run simulation based on given arguments
-Simulation initialize_simulation(PyObject *args)
+// Arguments shared by all functions that run a simulation
+struct SimulationArgs
 {
-    // simulation parameters and three strategy parameters
-    int iterations, players;
+    // simulation parameters and four strategy parameters
+    int players, iterations;
     int sp1 = -1;
     int sp2 = -1;
     int sp3 = -1;
     double sp4 = -1;
     const char *strategy_type = "default";
-    if (!PyArg_ParseTuple(args, "ii|siiid", &players, &iterations, &strategy_type, &sp1, &sp2, &sp3, &sp4))
-        return NULL;
+    SimulationOptions options;
+    // Bins for MMR-skill and games played histograms
+    int hist_bins = 100;
+    // Append actual memory usage to run_simulation results
+    bool memory_report = false;
+    // What was changed to fit the memory budget
+    std::vector<std::string> memory_notes;
+};
 
-    // Run simulation
-    return run_sim(players, iterations, sp1, sp2, sp3, sp4, strategy_type);
+// Returns false (with Python exception set) if there is no such built-in or loaded strategy
+bool check_strategy(const char *strategy_type)
+{
+    if (std::string(strategy_type) == "python_batch" && !batch_strategy_config.rate)
+    {
+        PyErr_SetString(PyExc_ValueError, "python_batch strategy needs a rate function (set_batch_strategy)");
+        return false;
+    }
+    if (is_builtin_strategy(strategy_type) || StrategyRegistry::instance().find(strategy_type))
+        return true;
+    PyErr_Format(PyExc_ValueError, "Unknown strategy: %s", strategy_type);
+    return false;
 }
 
-// Creates a numpy array from a vector of doubles
-PyObject *get_np_array(std::vector<double> vect)
+// Parses Python arguments. Returns false (with Python exception set) when they are invalid.
+// Options are keyword-only:
+// run_simulation(players, iterations, strategy, sp1, sp2, sp3, sp4, *,
+//                compact_history=False, tracking="all", track_sample=0, track_percentiles=(0, 100), track_every=1,
+//                bins=0, percentile_groups=10, hist_bins=100, regions=0, max_latency=0, candidate_index=False,
+//                good_match_sample=0, seed=-1, metrics_shm=None, metrics_every=10000,
+//                memory_budget=0, memory_policy="downgrade", memory_report=False,
+//                converge_every=10000, converge_prediction=0, converge_correlation=0, converge_sigma=0, converge_patience=3,
+//                skill_mean=1281.8, skill_stdev=363.6, skill_histogram=None)
+// `skill_histogram` is a file path (see `SkillDistribution::load_histogram`) and replaces the normal distribution.
+// Convergence criteria are off by default (see `ConvergenceCriteria`). Options not passed keep their values from `a`, so callers can set different defaults.
+bool parse_simulation_args(PyObject *args, PyObject *kwargs, SimulationArgs &a)
 {
-    double *carray = new double[vect.size()];
-    std::copy(vect.begin(), vect.end(), carray);
-    npy_intp m = vect.size();
-    return PyArray_SimpleNewFromData(1, &m, NPY_DOUBLE, carray);
+    static const char *kwlist[] = {"players", "iterations", "strategy", "sp1", "sp2", "sp3", "sp4",
+                                   "compact_history", "tracking", "track_sample", "track_percentiles", "track_every",
+                                   "bins", "percentile_groups", "hist_bins", "regions", "max_latency", "candidate_index",
+                                   "good_match_sample", "seed", "metrics_shm", "metrics_every",
+                                   "memory_budget", "memory_policy", "memory_report",
+                                   "converge_every", "converge_prediction", "converge_correlation", "converge_sigma", "converge_patience",
+                                   "skill_mean", "skill_stdev", "skill_histogram", NULL};
+    SimulationOptions &o = a.options;
+    int compact_history = o.history_encoding == HistoryEncoding::compact;
+    int candidate_index = o.candidate_index;
+    const char *tracking = NULL;
+    const char *metrics_shm = NULL;
+    const char *memory_policy = NULL;
+    int memory_report = a.memory_report;
+    double skill_mean = 2820 / 2.2;
+    double skill_stdev = 800 / 2.2;
+    const char *skill_histogram = NULL;
+    ConvergenceCriteria &c = o.convergence;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ii|siiid$psi(dd)iiiiidpiLziLzpidddiddz", const_cast<char **>(kwlist), &a.players, &a.iterations, &a.strategy_type, &a.sp1, &a.sp2, &a.sp3, &a.sp4,
+                                     &compact_history, &tracking, &o.track_sample, &o.track_percentile_min, &o.track_percentile_max, &o.track_every,
+                                     &o.aggregate_bins, &o.percentile_groups, &a.hist_bins, &o.regions, &o.max_latency, &candidate_index,
+                                     &o.good_match_sample, &o.seed, &metrics_shm, &o.metrics_every,
+                                     &o.memory_budget, &memory_policy, &memory_report,
+                                     &c.every, &c.prediction_tolerance, &c.correlation_tolerance, &c.sigma_threshold, &c.patience,
+                                     &skill_mean, &skill_stdev, &skill_histogram))
+        return false;
+    if (!check_strategy(a.strategy_type))
+        return false;
+    if (metrics_shm)
+        o.metrics_shm = metrics_shm;
+    a.memory_report = memory_report;
+
+    const std::string policy = memory_policy ? memory_policy : "downgrade";
+    if (policy == "refuse")
+        o.memory_refuse = true;
+    else if (policy != "downgrade")
+    {
+        PyErr_SetString(PyExc_ValueError, "memory_policy must be downgrade or refuse");
+        return false;
+    }
+    o.candidate_index = candidate_index;
+
+    if (compact_history)
+        o.history_encoding = HistoryEncoding::compact;
+
+    const std::string tracking_type = tracking ? tracking : "";
+    if (tracking == NULL)
+        ; // keep the default
+    else if (tracking_type == "all")
+        o.tracking = TrackingPolicy::all;
+    else if (tracking_type == "none")
+        o.tracking = TrackingPolicy::none;
+    else if (tracking_type == "sample")
+        o.tracking = TrackingPolicy::sample;
+    else if (tracking_type == "percentile")
+        o.tracking = TrackingPolicy::percentile;
+    else
+    {
+        PyErr_SetString(PyExc_ValueError, "tracking must be one of: all, none, sample, percentile");
+        return false;
+    }
+    if (o.track_every < 1)
+    {
+        PyErr_SetString(PyExc_ValueError, "track_every must be at least 1");
+        return false;
+    }
+    if (o.aggregate_bins < 0 || o.percentile_groups < 1 || a.hist_bins < 1)
+    {
+        PyErr_SetString(PyExc_ValueError, "bins, percentile_groups and hist_bins must be positive");
+        return false;
+    }
+    if (o.metrics_every < 1)
+    {
+        PyErr_SetString(PyExc_ValueError, "metrics_every must be at least 1");
+        return false;
+    }
+    if (skill_stdev <= 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "skill_stdev must be positive");
+        return false;
+    }
+    o.skill_distribution = SkillDistribution(skill_mean, skill_stdev);
+    std::string error;
+    if (skill_histogram && !o.skill_distribution.load_histogram(skill_histogram, error))
+    {
+        PyErr_SetString(PyExc_ValueError, error.c_str());
+        return false;
+    }
+    if (c.every < 1 || c.patience < 1 || c.prediction_tolerance < 0 || c.correlation_tolerance < 0 || c.sigma_threshold < 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "converge_every and converge_patience must be positive, tolerances can't be negative");
+        return false;
+    }
+    if (o.regions < 0 || (o.max_latency > 0 && o.regions == 0))
+    {
+        PyErr_SetString(PyExc_ValueError, "max_latency requires regions > 0");
+        return false;
+    }
+    return true;
 }
 
-// Creates a numpy array from a vector reference of doubles
-// Uses less memory as there is no data copy, but we need to make sure the owner of the vector loses its pointer
-PyObject *get_np_array_from_pointer(std::vector<double> *vect)
+// Creates the live metrics ring (if requested) before the simulation starts.
+// Returns false (with FileExistsError or OSError set) if the shared memory can't be created.
+bool open_metrics_ring(SimulationArgs &a)
 {
-    double *carray = &((*vect)[0]);
-    npy_intp m = vect->size();
-    return PyArray_SimpleNewFromData(1, &m, NPY_DOUBLE, carray);
+    SimulationOptions &o = a.options;
+    if (o.metrics_shm.empty())
+        return true;
+    if (!o.progress)
+        o.progress = std::make_shared<SimulationProgress>();
+    bool exists = false;
+    std::string error = o.progress->open_ring(o.metrics_shm, o.metrics_capacity, &exists);
+    if (error.empty())
+        return true;
+    PyErr_SetString(exists ? PyExc_FileExistsError : PyExc_OSError, error.c_str());
+    return false;
 }
 
-// Runs simulation and returns its data
-static PyObject *run_simulation(PyObject *self, PyObject *args)
+// Fits options of each of `simulations` simulations running at once into the memory budget.
+// Returns false (with MemoryError set) when the simulations shouldn't start.
+bool apply_memory_budget(SimulationArgs &a, int simulations = 1)
+{
+    if (a.options.memory_budget <= 0)
+        return true;
+    // Simulations running side by side share the budget
+    long long budget = a.options.memory_budget;
+    a.options.memory_budget = budget / simulations;
+    bool fits = fit_memory_budget(a.players, a.iterations, strategy_uses_sigma(a.strategy_type), a.options, a.memory_notes);
+    a.options.memory_budget = budget;
+    for (const std::string &note : a.memory_notes)
+        print("Memory budget:", note);
+    if (!fits)
+    {
+        std::string message = "Simulation doesn't fit into the memory budget: " + a.memory_notes.back();
+        PyErr_SetString(PyExc_MemoryError, message.c_str());
+    }
+    return fits;
+}
+
+// Sets the Python exception for an error caught from a simulation
+static void set_simulation_error(std::exception_ptr error)
+{
+    try
+    {
+        std::rethrow_exception(error);
+    }
+    catch (const std::bad_alloc &)
+    {
+        PyErr_SetString(PyExc_MemoryError, "Simulation ran out of memory");
+    }
+    catch (const std::exception &e)
+    {
+        PyErr_Format(PyExc_RuntimeError, "Simulation failed: %s", e.what());
+    }
+    catch (...)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Simulation failed");
+    }
+}
+
+// Initialize and run simulation based on parsed arguments
+// The GIL is released while the simulation runs, so other Python threads aren't blocked.
+// Returns nullptr (with the Python exception set) when the simulation fails.
+std::unique_ptr<Simulation> initialize_simulation(const SimulationArgs &a)
+{
+    std::unique_ptr<Simulation> sim;
+    std::exception_ptr error;
+    Py_BEGIN_ALLOW_THREADS
+    try
+    {
+        sim = std::make_unique<Simulation>(run_sim(a.players, a.iterations, a.sp1, a.sp2, a.sp3, a.sp4, a.strategy_type, false, a.options));
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+    Py_END_ALLOW_THREADS
+    if (error)
+        set_simulation_error(error);
+    return sim;
+}
+
+// Creates Python objects from the finished simulation:
+// [players, prediction_difference, match_accuracy, good_match_fraction(, aggregates)(, memory)(, convergence)]
+PyObject *get_simulation_result(Simulation &sim, int hist_bins, bool memory_report)
 {
-    Simulation sim = initialize_simulation(args);
+    // Measured before histories are handed over to Python
+    MemoryUsage usage = sim.memory_usage();
+    PyObject *Result_Aggregates = sim.aggregates ? get_aggregates(sim, hist_bins) : NULL;
     Timeit t;
     // Get data for players
     PyObject *Result_Players = PyList_New(0);
     for (Player &p : sim.players)
-        PyList_Append(Result_Players, Py_BuildValue("O", get_player_data(p)));
+        PyList_Append(Result_Players, Py_BuildValue("O", get_player_data(p, sim.skill_by_id)));
 
     // Here we first create numpy arrays based on the pointer of arrays
     // And then release the pointer so the data isn't destroyed when this function ends
@@ -89,6 +433,23 @@ static PyObject *run_simulation(PyObject *self, PyObject *args)
     PyList_Append(Result, Result_Predictions);
     PyList_Append(Result, Result_MatchAccuracy);
     PyList_Append(Result, Result_GoodMatchFraction);
+    if (Result_Aggregates)
+    {
+        PyList_Append(Result, Result_Aggregates);
+        Py_DECREF(Result_Aggregates);
+    }
+    if (memory_report)
+    {
+        PyObject *memory = get_memory_dict(usage);
+        PyList_Append(Result, memory);
+        Py_DECREF(memory);
+    }
+    if (sim.convergence)
+    {
+        PyObject *convergence = get_convergence_dict(*sim.convergence, sim.total_games_played);
+        PyList_Append(Result, convergence);
+        Py_DECREF(convergence);
+    }
 
     print("Creating Python objects for players finished in", t.s(), "seconds");
     // delete sim; // This is not necessary because we are using unique_ptr class and
@@ -96,62 +457,125 @@ static PyObject *run_simulation(PyObject *self, PyObject *args)
     return Result;
 }
 
-// Runs parameter optimization and returns its data
-static PyObject *run_parameter_optimization(PyObject *self, PyObject *args)
+// Runs simulation and returns its data
+static PyObject *run_simulation(PyObject *self, PyObject *args, PyObject *kwargs)
 {
-    Simulation sim = initialize_simulation(args);
-    // Get prediction sums
-    const int LATE_GAMES = 1000;
+    SimulationArgs a;
+    if (!parse_simulation_args(args, kwargs, a))
+        return NULL;
+    if (!apply_memory_budget(a) || !open_metrics_ring(a))
+        return NULL;
+    std::unique_ptr<Simulation> sim = initialize_simulation(a);
+    if (!sim)
+        return NULL;
+    return get_simulation_result(*sim, a.hist_bins, a.memory_report);
+}
+
+// Runs simulation and returns only aggregated data (see `get_aggregates`).
+// Raw per-game vectors and player histories are not recorded at all by default.
+static PyObject *run_simulation_aggregated(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    SimulationArgs a;
+    a.options.aggregate_bins = 200;
+    a.options.record_raw = false;
+    a.options.tracking = TrackingPolicy::none;
+    if (!parse_simulation_args(args, kwargs, a))
+        return NULL;
+    if (a.options.aggregate_bins < 1)
+    {
+        PyErr_SetString(PyExc_ValueError, "bins must be positive");
+        return NULL;
+    }
+    if (!apply_memory_budget(a) || !open_metrics_ring(a))
+        return NULL;
+    std::unique_ptr<Simulation> sim = initialize_simulation(a);
+    if (!sim)
+        return NULL;
+    return get_aggregates(*sim, a.hist_bins);
+}
+
+// Returns sums of prediction differences of all games and of the last `late_games` games, and the numbers of games
+// they were summed over
+static std::vector<double> prediction_sums(const Simulation &sim, size_t late_games)
+{
+    const std::vector<double> &diffs = *sim.prediction_difference;
     double match_sum = 0;
     double match_sum_late = 0;
-    for (int i = 0; i < sim.prediction_difference->size(); i++)
+    size_t late_start = diffs.size() > late_games ? diffs.size() - late_games : 0;
+    for (size_t i = 0; i < diffs.size(); i++)
     {
-        match_sum += (*(sim.prediction_difference))[i];
-        if (i + LATE_GAMES >= sim.prediction_difference->size())
-            match_sum_late += (*(sim.prediction_difference))[i];
+        match_sum += diffs[i];
+        if (i >= late_start)
+            match_sum_late += diffs[i];
     }
+    std::vector<double> out = {match_sum, match_sum_late, static_cast<double>(diffs.size()), static_cast<double>(diffs.size() - late_start)};
+    return out;
+}
+
+// Runs parameter optimization and returns its data
+static PyObject *run_parameter_optimization(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    SimulationArgs a;
+    if (!parse_simulation_args(args, kwargs, a))
+        return NULL;
+    if (!apply_memory_budget(a) || !open_metrics_ring(a))
+        return NULL;
+    std::unique_ptr<Simulation> sim_ptr = initialize_simulation(a);
+    if (!sim_ptr)
+        return NULL;
+    Simulation &sim = *sim_ptr;
+    // Get prediction sums
+    const int LATE_GAMES = 1000;
+    std::vector<double> sums = prediction_sums(sim, LATE_GAMES);
 
+    // [sum / 100000, mean of the last games, mean per game (comparable when runs stop early)(, games to convergence)]
     PyObject *Result = PyList_New(0);
-    PyList_Append(Result, Py_BuildValue("f", match_sum / 100000));
-    PyList_Append(Result, Py_BuildValue("f", match_sum_late / LATE_GAMES));
+    PyList_Append(Result, Py_BuildValue("f", sums[0] / 100000));
+    PyList_Append(Result, Py_BuildValue("f", sums[1] / LATE_GAMES));
+    PyList_Append(Result, Py_BuildValue("f", sums[0] / std::max(sums[2], 1.0)));
+    // Games to convergence (-1 if it didn't converge) when convergence criteria are set
+    if (sim.convergence)
+        PyList_Append(Result, Py_BuildValue("L", sim.convergence->converged_at));
     return Result;
 }
 
-std::vector<double> parameter_optimization_worker(int players, int iterations, int sp1, int sp2, int sp3, double sp4, const std::string &strategy_type, int LATE_GAMES)
+// Returns prediction sums of one simulation (see `prediction_sums`) and games to convergence (-1 if not converged)
+std::vector<double> parameter_optimization_worker(int players, int iterations, int sp1, int sp2, int sp3, double sp4, const std::string &strategy_type, int LATE_GAMES, SimulationOptions options, size_t threads)
 {
-    double match_sum = 0;
-    double match_sum_late = 0;
-
+    // Workers share the cores
+    set_chunk_threads(threads);
     // Run simulation
-    Simulation sim = run_sim(players, iterations, sp1, sp2, sp3, sp4, strategy_type);
+    Simulation sim = run_sim(players, iterations, sp1, sp2, sp3, sp4, strategy_type, false, options);
 
-    // Get prediction sums
-    for (int i = 0; i < sim.prediction_difference->size(); i++)
-    {
-        match_sum += (*(sim.prediction_difference))[i];
-        if (i + LATE_GAMES >= sim.prediction_difference->size())
-            match_sum_late += (*(sim.prediction_difference))[i];
-    }
-    std::vector<double> out = {match_sum, match_sum_late};
+    std::vector<double> out = prediction_sums(sim, LATE_GAMES);
+    out.push_back(sim.convergence ? static_cast<double>(sim.convergence->converged_at) : -1);
     return out;
 }
 
 // Runs parameter optimization multithreaded and returns its data
-static PyObject *run_parameter_optimization_nt(PyObject *self, PyObject *args)
+static PyObject *run_parameter_optimization_nt(PyObject *self, PyObject *args, PyObject *kwargs)
 {
     const int ITERATIONS = 3;
     const int LATE_GAMES = 1000;
     double total_match_sum = 0;
     double total_match_sum_late = 0;
+    double total_games = 0;
+    double match_mean = 0;
+    // Mean games to convergence, -1 if any of the simulations didn't converge
+    double converged_at = 0;
+    std::exception_ptr error;
 
     // Parse python data here
-    int iterations, players;
-    int sp1 = -1;
-    int sp2 = -1;
-    int sp3 = -1;
-    double sp4 = -1;
-    const char *strategy_type = "default";
-    if (!PyArg_ParseTuple(args, "ii|siiid", &players, &iterations, &strategy_type, &sp1, &sp2, &sp3, &sp4))
+    SimulationArgs a;
+    if (!parse_simulation_args(args, kwargs, a))
+        return NULL;
+    // All simulations would publish into the same segment
+    if (!a.options.metrics_shm.empty())
+    {
+        PyErr_SetString(PyExc_ValueError, "metrics_shm isn't supported by run_parameter_optimization_nt");
+        return NULL;
+    }
+    if (!apply_memory_budget(a, ITERATIONS))
         return NULL;
 
     // Release GIL here, doesn't hurt Python multiprocessing and improves
@@ -160,32 +584,443 @@ static PyObject *run_parameter_optimization_nt(PyObject *self, PyObject *args)
         std::vector<std::future<std::vector<double>>>
             futures;
 
+    size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency() / ITERATIONS);
     for (int iter = 0; iter < ITERATIONS; iter++)
-        futures.push_back(std::async(std::launch::async, parameter_optimization_worker, players, iterations, sp1, sp2, sp3, sp4, strategy_type, LATE_GAMES));
+    {
+        // A fixed seed would make all iterations the same
+        SimulationOptions options = a.options;
+        if (options.seed >= 0)
+            options.seed += iter;
+        futures.push_back(std::async(std::launch::async, parameter_optimization_worker, a.players, a.iterations, a.sp1, a.sp2, a.sp3, a.sp4, a.strategy_type, LATE_GAMES, options, threads));
+    }
 
+    // Every simulation is waited for, the first failure is raised after the GIL is taken again
     std::vector<double> results;
     for (auto &f : futures)
     {
-        results = f.get();
+        try
+        {
+            results = f.get();
+        }
+        catch (...)
+        {
+            if (!error)
+                error = std::current_exception();
+            continue;
+        }
         total_match_sum += results[0];
         total_match_sum_late += results[1];
+        total_games += results[2];
+        converged_at = results[4] < 0 || converged_at < 0 ? -1 : converged_at + results[4] / ITERATIONS;
     }
 
+    match_mean = total_match_sum / std::max(total_games, 1.0);
     total_match_sum /= ITERATIONS * 100000;
     total_match_sum_late /= ITERATIONS * LATE_GAMES;
     Py_END_ALLOW_THREADS
+    if (error)
+    {
+        set_simulation_error(error);
+        return NULL;
+    }
 
+        // Same as run_parameter_optimization
         PyObject *Result = PyList_New(0);
     PyList_Append(Result, Py_BuildValue("f", total_match_sum));
     PyList_Append(Result, Py_BuildValue("f", total_match_sum_late));
+    PyList_Append(Result, Py_BuildValue("f", match_mean));
+    if (a.options.convergence.enabled())
+        PyList_Append(Result, Py_BuildValue("L", static_cast<long long>(converged_at)));
+    return Result;
+}
+
+// Estimates memory of a simulation without running it. Takes the same arguments as run_simulation.
+// With memory_budget set, also returns what would be changed to fit it (`notes`), resulting options and
+// whether the simulation would start (`fits`).
+static PyObject *estimate_simulation_memory(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    SimulationArgs a;
+    if (!parse_simulation_args(args, kwargs, a))
+        return NULL;
+    SimulationOptions &o = a.options;
+    bool track_sigma = strategy_uses_sigma(a.strategy_type);
+    bool fits = fit_memory_budget(a.players, a.iterations, track_sigma, o, a.memory_notes);
+
+    PyObject *Result = get_memory_dict(estimate_memory(a.players, a.iterations, track_sigma, o));
+    PyObject *notes = PyList_New(0);
+    for (const std::string &note : a.memory_notes)
+    {
+        PyObject *text = PyUnicode_FromString(note.c_str());
+        PyList_Append(notes, text);
+        Py_DECREF(text);
+    }
+    const char *tracking[] = {"none", "all", "sample", "percentile"};
+    PyObject *info = Py_BuildValue("{sOsNsOsOsssisisi}",
+                                   "fits", fits ? Py_True : Py_False,
+                                   "notes", notes,
+                                   "record_raw", o.record_raw ? Py_True : Py_False,
+                                   "compact_history", o.history_encoding == HistoryEncoding::compact ? Py_True : Py_False,
+                                   "tracking", tracking[static_cast<int>(o.tracking)],
+                                   "track_sample", o.track_sample,
+                                   "track_every", o.track_every,
+                                   "bins", o.aggregate_bins);
+    PyDict_Update(Result, info);
+    Py_DECREF(info);
+    return Result;
+}
+
+// Replays a match log with a strategy and returns binned statistics and final ratings.
+// replay_match_log(path, strategy, sp1, sp2, sp3, sp4, *, format=None, bins=200, compact_history=False,
+//                  tracking="none", track_sample=0, track_every=1, record_raw=False)
+// Format is "binary" or "csv" (default: csv for *.csv files, binary otherwise). See `MatchLog` for the layouts.
+// Final ratings are indexed by player in order of appearance, `log_id` maps them back to ids in the log.
+// Tracked players (tracking="all" or "sample") are returned in `players` with their histories.
+static PyObject *replay_match_log(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char *kwlist[] = {"path", "strategy", "sp1", "sp2", "sp3", "sp4",
+                                   "format", "bins", "compact_history", "tracking", "track_sample", "track_every", "record_raw", NULL};
+    const char *path;
+    const char *strategy_type = "default";
+    int sp1 = -1, sp2 = -1, sp3 = -1;
+    double sp4 = -1;
+    const char *format = NULL;
+    const char *tracking = "none";
+    int compact_history = 0;
+    int record_raw = 0;
+    SimulationOptions options;
+    options.aggregate_bins = 200;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|siiid$zipsiip", const_cast<char **>(kwlist), &path, &strategy_type, &sp1, &sp2, &sp3, &sp4,
+                                     &format, &options.aggregate_bins, &compact_history, &tracking, &options.track_sample, &options.track_every, &record_raw))
+        return NULL;
+    if (!check_strategy(strategy_type))
+        return NULL;
+
+    const std::string tracking_type = tracking;
+    if (tracking_type == "none")
+        options.tracking = TrackingPolicy::none;
+    else if (tracking_type == "all")
+        options.tracking = TrackingPolicy::all;
+    else if (tracking_type == "sample")
+        options.tracking = TrackingPolicy::sample;
+    else
+    {
+        PyErr_SetString(PyExc_ValueError, "tracking must be one of: none, all, sample");
+        return NULL;
+    }
+    if (options.aggregate_bins < 1 || options.track_every < 1)
+    {
+        PyErr_SetString(PyExc_ValueError, "bins and track_every must be positive");
+        return NULL;
+    }
+    if (compact_history)
+        options.history_encoding = HistoryEncoding::compact;
+    options.record_raw = record_raw;
+
+    std::string path_str = path;
+    MatchLogFormat log_format = MatchLogFormat::binary;
+    const std::string format_type = format ? format : "";
+    if (format_type == "csv" || (format == NULL && path_str.size() >= 4 && path_str.compare(path_str.size() - 4, 4, ".csv") == 0))
+        log_format = MatchLogFormat::csv;
+    else if (format != NULL && format_type != "binary")
+    {
+        PyErr_SetString(PyExc_ValueError, "format must be binary or csv");
+        return NULL;
+    }
+
+    MatchLog log(path_str, log_format);
+    if (!log.is_open())
+    {
+        PyErr_SetString(PyExc_OSError, log.error.c_str());
+        return NULL;
+    }
+
+    std::unique_ptr<Simulation> sim;
+    std::exception_ptr error;
+    Timeit t;
+    Py_BEGIN_ALLOW_THREADS
+    try
+    {
+        sim = std::make_unique<Simulation>(replay_sim(log, sp1, sp2, sp3, sp4, strategy_type, options));
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+    Py_END_ALLOW_THREADS
+    if (error)
+    {
+        set_simulation_error(error);
+        return NULL;
+    }
+    double seconds = t.s();
+
+    PyObject *Result = PyDict_New();
+    set_binned_series(Result, *sim->aggregates);
+
+    std::vector<double> log_ids(sim->log_ids.begin(), sim->log_ids.end());
+    std::vector<double> mmrs, sigmas, games;
+    for (Player &p : sim->players)
+    {
+        mmrs.push_back(p.mmr);
+        sigmas.push_back(p.sigma);
+        games.push_back(p.games_played);
+    }
+    set_dict_array(Result, "log_id", get_np_array_copy(log_ids));
+    set_dict_array(Result, "mmr", get_np_array_copy(mmrs));
+    set_dict_array(Result, "sigma", get_np_array_copy(sigmas));
+    set_dict_array(Result, "games_played", get_np_array_copy(games));
+
+    if (options.tracking != TrackingPolicy::none)
+    {
+        PyObject *Players = PyList_New(0);
+        for (Player &p : sim->players)
+        {
+            if (!p.history)
+                continue;
+            PyObject *data = get_player_data(p, sim->skill_by_id);
+            PyObject *log_id = PyLong_FromUnsignedLong(sim->log_ids[p.id]);
+            PyDict_SetItemString(data, "log_id", log_id);
+            Py_DECREF(log_id);
+            PyList_Append(Players, data);
+            Py_DECREF(data);
+        }
+        PyDict_SetItemString(Result, "players", Players);
+        Py_DECREF(Players);
+    }
+    if (options.record_raw)
+    {
+        set_dict_array(Result, "prediction_difference", get_np_array_from_pointer(sim->prediction_difference.release()));
+        set_dict_array(Result, "match_accuracy", get_np_array_from_pointer(sim->match_accuracy.release()));
+    }
+
+    PyObject *info = Py_BuildValue("{sLsdsdsLsL}",
+                                   "games", sim->total_games_played,
+                                   "seconds", seconds,
+                                   "games_per_second", seconds > 0 ? sim->total_games_played / seconds : 0.0,
+                                   "out_of_order", sim->replay_out_of_order,
+                                   "invalid_lines", log.invalid_lines);
+    PyDict_Update(Result, info);
+    Py_DECREF(info);
+    return Result;
+}
+
+//
+// STRATEGY PLUGINS
+//
+
+// Loads strategies from a shared library (see cpp/psim_strategy.h) and returns their names.
+// They can then be used as `strategy` in all simulation functions.
+static PyObject *load_strategy_plugin(PyObject *self, PyObject *args)
+{
+    const char *path;
+    if (!PyArg_ParseTuple(args, "s", &path))
+        return NULL;
+    std::string error;
+    std::vector<std::string> names = StrategyRegistry::instance().load(path, error);
+    if (!error.empty())
+    {
+        PyErr_SetString(PyExc_ImportError, error.c_str());
+        return NULL;
+    }
+    PyObject *Result = PyList_New(0);
+    for (const std::string &name : names)
+    {
+        PyObject *value = PyUnicode_FromString(name.c_str());
+        PyList_Append(Result, value);
+        Py_DECREF(value);
+    }
+    return Result;
+}
+
+// Returns description and parameter schema of a loaded plugin strategy
+static PyObject *strategy_info(PyObject *self, PyObject *args)
+{
+    const char *name;
+    if (!PyArg_ParseTuple(args, "s", &name))
+        return NULL;
+    const psim_strategy *api = StrategyRegistry::instance().find(name);
+    if (!api)
+    {
+        PyErr_Format(PyExc_KeyError, "No plugin strategy %s", name);
+        return NULL;
+    }
+    PyObject *params = PyList_New(0);
+    for (uint32_t i = 0; i < api->param_count; i++)
+    {
+        const psim_param &p = api->params[i];
+        PyObject *param = Py_BuildValue("{szszsdsdsd}", "name", p.name, "description", p.description,
+                                        "default", p.default_value, "min", p.min_value, "max", p.max_value);
+        PyList_Append(params, param);
+        Py_DECREF(param);
+    }
+    return Py_BuildValue("{szszsOsdsdsN}", "name", api->name, "description", api->description,
+                         "uses_sigma", api->uses_sigma ? Py_True : Py_False,
+                         "initial_mmr", api->initial_mmr, "initial_sigma", api->initial_sigma, "params", params);
+}
+
+// Returns names of built-in and loaded strategies
+static PyObject *list_strategies(PyObject *self, PyObject *args)
+{
+    std::vector<std::string> names = builtin_strategies();
+    for (const std::string &name : StrategyRegistry::instance().names())
+        names.push_back(name);
+    PyObject *Result = PyList_New(0);
+    for (const std::string &name : names)
+    {
+        PyObject *value = PyUnicode_FromString(name.c_str());
+        PyList_Append(Result, value);
+        Py_DECREF(value);
+    }
     return Result;
 }
 
+//
+// ASYNC SIMULATIONS
+// start_simulation returns a handle, other functions take it as their only argument.
+//
+
+struct AsyncEntry
+{
+    std::unique_ptr<AsyncSimulation> simulation;
+    int hist_bins;
+    bool memory_report;
+};
+
+// Simulations started from Python by their handle. Only accessed with the GIL held.
+static std::map<int, AsyncEntry> async_simulations;
+static int next_async_handle = 1;
+
+// Cancels and joins a simulation. The GIL is released, the simulation thread might be waiting for it
+// in a Python callback (trueskill, python_batch).
+void stop_async_simulation(AsyncSimulation &simulation)
+{
+    Py_BEGIN_ALLOW_THREADS
+    simulation.cancel();
+    simulation.wait();
+    Py_END_ALLOW_THREADS
+}
+
+// Returns the entry for a handle passed in `args` (or NULL with Python exception set)
+AsyncEntry *get_async_entry(PyObject *args, int &handle)
+{
+    if (!PyArg_ParseTuple(args, "i", &handle))
+        return NULL;
+    auto it = async_simulations.find(handle);
+    if (it == async_simulations.end())
+    {
+        PyErr_SetString(PyExc_KeyError, "Unknown simulation handle");
+        return NULL;
+    }
+    return &it->second;
+}
+
+// Starts a simulation on a new thread and returns its handle. Takes the same arguments as run_simulation.
+static PyObject *start_simulation(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    SimulationArgs a;
+    if (!parse_simulation_args(args, kwargs, a))
+        return NULL;
+    if (!apply_memory_budget(a) || !open_metrics_ring(a))
+        return NULL;
+    int handle = next_async_handle++;
+    async_simulations[handle] = AsyncEntry{std::make_unique<AsyncSimulation>(a.players, a.iterations, a.sp1, a.sp2, a.sp3, a.sp4, a.strategy_type, a.options), a.hist_bins, a.memory_report};
+    return PyLong_FromLong(handle);
+}
+
+// Returns a dictionary with progress and the latest published metrics
+static PyObject *simulation_progress(PyObject *self, PyObject *args)
+{
+    int handle;
+    AsyncEntry *entry = get_async_entry(args, handle);
+    if (entry == NULL)
+        return NULL;
+
+    SimulationProgress &progress = *entry->simulation->progress;
+    MetricsSnapshot snapshot = progress.snapshot();
+    long long games = progress.games_played.load();
+    long long target = progress.target_games.load();
+    double elapsed = progress.elapsed_seconds();
+    double rate = elapsed > 0 ? games / elapsed : 0;
+    double eta = rate > 0 ? std::max(0LL, target - games) / rate : -1;
+
+    return Py_BuildValue("{sLsLsdsdsdsOsOsdsdsd}",
+                         "games_played", games,
+                         "target_games", target,
+                         "games_per_second", rate,
+                         "elapsed_seconds", elapsed,
+                         "eta_seconds", eta,
+                         "finished", progress.finished.load() ? Py_True : Py_False,
+                         "cancelled", progress.cancelled.load() ? Py_True : Py_False,
+                         "prediction_difference", snapshot.prediction_difference,
+                         "match_accuracy", snapshot.match_accuracy,
+                         "good_match_fraction", snapshot.good_match_fraction);
+}
+
+// Asks the simulation to stop. Data played so far can still be fetched with simulation_result.
+static PyObject *cancel_simulation(PyObject *self, PyObject *args)
+{
+    int handle;
+    AsyncEntry *entry = get_async_entry(args, handle);
+    if (entry == NULL)
+        return NULL;
+    entry->simulation->cancel();
+    Py_RETURN_NONE;
+}
+
+// Waits for the simulation (without holding the GIL) and returns the same data as run_simulation.
+// The handle is invalid as soon as this is called.
+static PyObject *simulation_result(PyObject *self, PyObject *args)
+{
+    int handle;
+    AsyncEntry *found = get_async_entry(args, handle);
+    if (found == NULL)
+        return NULL;
+    // Taken out of the map before the GIL is released, so other Python threads can't wait for it or erase it too
+    AsyncEntry entry = std::move(*found);
+    async_simulations.erase(handle);
+
+    Py_BEGIN_ALLOW_THREADS
+    entry.simulation->wait();
+    Py_END_ALLOW_THREADS
+
+    if (entry.simulation->error)
+    {
+        set_simulation_error(entry.simulation->error);
+        return NULL;
+    }
+
+    return get_simulation_result(*entry.simulation->result, entry.hist_bins, entry.memory_report);
+}
+
+// Stops simulations that were never collected. Registered with atexit so it runs while Python still works;
+// destroying them later (static destructors) would join threads that may need the GIL.
+static PyObject *stop_simulations(PyObject *self, PyObject *args)
+{
+    // Taken out of the map first, the GIL is released while each one is stopped
+    std::map<int, AsyncEntry> entries;
+    entries.swap(async_simulations);
+    for (auto &entry : entries)
+        stop_async_simulation(*entry.second.simulation);
+    Py_RETURN_NONE;
+}
+
 /* Module methods (how it's called for python | how it's called here | arg-type | docstring) METH_VARARGS/METH_KEYWORDS/METH_NOARGS */
 static PyMethodDef module_methods[] = {
-    {"run_simulation", run_simulation, METH_VARARGS, "Runs a simulation with `players` and `iterations`"},
-    {"run_parameter_optimization", run_parameter_optimization, METH_VARARGS, "Runs parameter optimization`"},
-    {"run_parameter_optimization_nt", run_parameter_optimization_nt, METH_VARARGS, "Runs parameter optimization NT`"},
+    {"run_simulation", (PyCFunction)(void (*)(void))run_simulation, METH_VARARGS | METH_KEYWORDS, "Runs a simulation with `players` and `iterations`"},
+    {"run_simulation_aggregated", (PyCFunction)(void (*)(void))run_simulation_aggregated, METH_VARARGS | METH_KEYWORDS, "Runs a simulation and returns binned statistics instead of raw data"},
+    {"run_parameter_optimization", (PyCFunction)(void (*)(void))run_parameter_optimization, METH_VARARGS | METH_KEYWORDS, "Runs parameter optimization`"},
+    {"run_parameter_optimization_nt", (PyCFunction)(void (*)(void))run_parameter_optimization_nt, METH_VARARGS | METH_KEYWORDS, "Runs parameter optimization NT`"},
+    {"estimate_memory", (PyCFunction)(void (*)(void))estimate_simulation_memory, METH_VARARGS | METH_KEYWORDS, "Estimates memory of a simulation (and what a memory budget would change)"},
+    {"replay_match_log", (PyCFunction)(void (*)(void))replay_match_log, METH_VARARGS | METH_KEYWORDS, "Replays a binary or CSV match log with a strategy"},
+    {"start_simulation", (PyCFunction)(void (*)(void))start_simulation, METH_VARARGS | METH_KEYWORDS, "Starts a simulation on a native thread and returns its handle"},
+    {"simulation_progress", simulation_progress, METH_VARARGS, "Returns progress and latest metrics of a started simulation"},
+    {"cancel_simulation", cancel_simulation, METH_VARARGS, "Cancels a started simulation"},
+    {"simulation_result", simulation_result, METH_VARARGS, "Waits for a started simulation and returns its data"},
+    {"_stop_simulations", stop_simulations, METH_NOARGS, "Cancels and discards all started simulations (called at exit)"},
+    {"load_strategy_plugin", load_strategy_plugin, METH_VARARGS, "Loads strategies from a shared library and returns their names"},
+    {"strategy_info", strategy_info, METH_VARARGS, "Returns description and parameters of a plugin strategy"},
+    {"list_strategies", list_strategies, METH_NOARGS, "Returns names of all available strategies"},
+    {"set_batch_strategy", (PyCFunction)(void (*)(void))set_batch_strategy, METH_VARARGS | METH_KEYWORDS, "Sets the Python function that rates batches of games for the python_batch strategy"},
     {"set_my_python_function", set_trueskill_rate_1v1, METH_VARARGS, "set_my_python_function doc"},
     {NULL, NULL, 0, NULL} // Last needs to be this
 };
@@ -205,5 +1040,21 @@ PyMODINIT_FUNC PyInit_psimulation(void)
         NULL};
 
     import_array(); // necessary for numpy initialization
-    return PyModule_Create(&moduledef);
+    PyObject *module = PyModule_Create(&moduledef);
+    if (module == NULL)
+        return NULL;
+
+    // Running simulations have to be stopped before the interpreter shuts down
+    PyObject *atexit = PyImport_ImportModule("atexit");
+    PyObject *stop = PyObject_GetAttrString(module, "_stop_simulations");
+    PyObject *registered = atexit && stop ? PyObject_CallMethod(atexit, "register", "O", stop) : NULL;
+    Py_XDECREF(registered);
+    Py_XDECREF(stop);
+    Py_XDECREF(atexit);
+    if (registered == NULL)
+    {
+        Py_DECREF(module);
+        return NULL;
+    }
+    return module;
 }
\ No newline at end of file
@@ -5,6 +5,9 @@
 #include <chrono>
 #include <random>
 #include <memory>
+#include <cmath>
+#include <algorithm>
+#include <limits>
 
 Simulation::Simulation(std::unique_ptr<MatchmakingStrategy> strat)
 {
@@ -20,21 +23,134 @@ Simulation::Simulation(std::unique_ptr<MatchmakingStrategy> strat)
     good_match_fraction.reset(new std::vector<double>);
 }
 
+// Reseeds the random engine. Call before adding players for a fully reproducible run.
+void Simulation::seed(unsigned int value)
+{
+    m_RNG.seed(value);
+}
+
 // Adds `number` of players to the simulation
 void Simulation::add_players(int number)
 {
-    for (int i = 0; i < number; i++)
-        players.push_back(Player(m_skill_distribution(m_RNG)));
+    if (number <= 0)
+        return;
+    int first_new_player = static_cast<int>(players.size());
+    int first_id = static_cast<int>(skill_by_id.size());
+    players.resize(players.size() + number);
+    skill_by_id.resize(skill_by_id.size() + number);
 
-    // change player defaults if forced by the strategy
-    for (auto &player : players)
+    // New players are initialized in parallel chunks, each with its own random stream
+    uint64_t population_seed = (static_cast<uint64_t>(m_RNG()) << 32) ^ m_RNG();
+    // Only players that are tracked get a history (the sample is picked afterwards, see apply_tracking_policy)
+    bool track_all = m_tracking == TrackingPolicy::all;
+    bool track_percentile = m_tracking == TrackingPolicy::percentile;
+    bool track_sigma = m_strategy->uses_sigma();
+    for_each_chunk(number, [&](size_t chunk, size_t begin, size_t end)
+                   {
+                       std::mt19937_64 rng = chunk_engine(population_seed, chunk);
+                       skill_distribution.sample(rng, &skill_by_id[first_id + begin], end - begin);
+                       for (size_t i = begin; i < end; i++)
+                       {
+                           Player &p = players[first_new_player + i];
+                           p.id = first_id + static_cast<int>(i);
+                           p.skill = static_cast<rating_t>(skill_by_id[p.id]);
+                           // Change player defaults if forced by the strategy
+                           if (m_force_player_mmr > -1.0)
+                               p.mmr = static_cast<rating_t>(m_force_player_mmr);
+                           if (m_force_player_sigma > -1.0)
+                               p.sigma = static_cast<rating_t>(m_force_player_sigma);
+                           if (track_all || (track_percentile && in_tracked_percentiles(p.skill)))
+                               p.start_tracking(m_history_encoding, track_sigma, m_track_every);
+                           if (latency_model)
+                               latency_model->place(rng, p.region, p.x, p.y);
+                       }
+                   });
+    if (m_tracking == TrackingPolicy::sample)
+        apply_tracking_policy(first_new_player);
+    if (candidate_index)
+        candidate_index->invalidate();
+    // New players have to converge too
+    if (convergence)
+        convergence->reset();
+}
+// MMR at 0%, 10%, ..., 100% of the population. Large populations are estimated from evenly spaced players.
+std::array<double, MetricsRecord::MMR_QUANTILES> Simulation::mmr_quantiles()
+{
+    const size_t SAMPLE = 1024;
+    std::array<double, MetricsRecord::MMR_QUANTILES> quantiles{};
+    if (players.empty())
+        return quantiles;
+
+    size_t step = std::max<size_t>(1, players.size() / SAMPLE);
+    std::vector<double> mmrs;
+    for (size_t i = 0; i < players.size(); i += step)
+        mmrs.push_back(players[i].mmr);
+    std::sort(mmrs.begin(), mmrs.end());
+    for (int q = 0; q < MetricsRecord::MMR_QUANTILES; q++)
+        quantiles[q] = mmrs[(mmrs.size() - 1) * q / (MetricsRecord::MMR_QUANTILES - 1)];
+    return quantiles;
+}
+
+// Bytes currently used by the main structures
+MemoryUsage Simulation::memory_usage() const
+{
+    MemoryUsage usage;
+    usage.players = static_cast<double>(players.capacity() * sizeof(Player));
+    usage.skill_by_id = static_cast<double>(skill_by_id.capacity() * sizeof(double));
+    for (const Player &p : players)
+        if (p.history)
+            usage.histories += sizeof(PlayerHistory) + p.history->bytes();
+    for (const std::unique_ptr<std::vector<double>> *raw : {&prediction_difference, &match_accuracy, &good_match_fraction})
+        if (*raw)
+            usage.raw_metrics += static_cast<double>((*raw)->capacity() * sizeof(double));
+    if (aggregates)
+        usage.aggregates = static_cast<double>(aggregates->bytes());
+    if (candidate_index)
+        usage.candidate_index = static_cast<double>(candidate_index->bytes());
+    return usage;
+}
+
+// Returns the percentile (0-100) of `skill` in the skill distribution.
+// Computed from the distribution itself, so it doesn't depend on when the player was added.
+double Simulation::skill_percentile(double skill)
+{
+    return skill_distribution.percentile(skill);
+}
+
+// Whether a player with `skill` is tracked by TrackingPolicy::percentile
+bool Simulation::in_tracked_percentiles(double skill)
+{
+    double percentile = skill_percentile(skill);
+    return percentile >= m_track_percentile_min && percentile <= m_track_percentile_max;
+}
+
+// Picks which of the newly added players join the tracked sample (TrackingPolicy::sample) and starts their histories.
+// Reservoir sampling → uniform sample over all players added so far, even when they are added gradually.
+// A player dropped from the sample loses his recorded history.
+void Simulation::apply_tracking_policy(int first_new_player)
+{
+    bool track_sigma = m_strategy->uses_sigma();
+    for (int i = first_new_player; i < static_cast<int>(players.size()); i++)
     {
-        if (m_force_player_mmr > -1.0)
-            player.mmr = m_force_player_mmr;
-        if (m_force_player_sigma > -1.0)
-            player.sigma = m_force_player_sigma;
+        Player &p = players[i];
+        if (static_cast<int>(m_sampled_ids.size()) < m_track_sample)
+        {
+            m_sampled_ids.push_back(p.id);
+            p.start_tracking(m_history_encoding, track_sigma, m_track_every);
+            continue;
+        }
+        int r = static_cast<int>(m_RNG() % (p.id + 1));
+        if (r >= m_track_sample)
+            continue;
+        // Players are ordered by id without gaps, unless the evicted player was already removed
+        int evicted = m_sampled_ids[r] - players.front().id;
+        if (evicted >= 0)
+            players[evicted].stop_tracking();
+        m_sampled_ids[r] = p.id;
+        p.start_tracking(m_history_encoding, track_sigma, m_track_every);
     }
 }
+
 void Simulation::add_players(double number)
 {
     add_players(static_cast<int>(number));
@@ -47,6 +163,8 @@ void Simulation::remove_players(int number)
         players.clear();
     else
         players.erase(players.begin(), players.begin() + number);
+    if (candidate_index)
+        candidate_index->invalidate();
 }
 
 // Returns a chance of player p1 winning (based on skill)
@@ -59,13 +177,39 @@ double Simulation::get_chance(Player &p1, Player &p2)
 void Simulation::resolve_game(Player &p1, Player &p2)
 {
     double p1_chance = get_chance(p1, p2);
-    match_accuracy->push_back(std::abs(p1_chance - 0.5));
+    double match_acc = std::abs(p1_chance - 0.5);
     double pred_diff;
     if (m_RNG() % 10000 <= 10000 * p1_chance)
         pred_diff = m_strategy->update_mmr(p1, p2, p1_chance);
     else
         pred_diff = m_strategy->update_mmr(p2, p1, 1 - p1_chance);
 
+    if (aggregates)
+    {
+        aggregates->add_game(total_games_played, pred_diff, match_acc, skill_percentile(p1.skill), skill_percentile(p2.skill));
+        if (latency_model)
+            aggregates->add_latency(total_games_played, latency_model->latency(p1.x, p1.y, p2.x, p2.y), match_acc);
+    }
+    if (candidate_index)
+        candidate_index->game_played();
+    record_metrics(pred_diff, match_acc);
+}
+
+// Reports game metrics to progress and raw vectors
+void Simulation::record_metrics(double pred_diff, double match_acc)
+{
+    if (progress && progress->publish_due())
+        progress->set_mmr_quantiles(mmr_quantiles());
+    if (progress)
+        progress->add_game(pred_diff, match_acc);
+    total_games_played++;
+    if (convergence)
+        convergence->add_game(pred_diff);
+
+    if (!m_record_raw)
+        return;
+
+    match_accuracy->push_back(match_acc);
     try
     {
         prediction_difference->push_back(pred_diff);
@@ -76,6 +220,16 @@ void Simulation::resolve_game(Player &p1, Player &p2)
     }
 }
 
+// Checks convergence once the strategy has applied the game (called after `game_finished`)
+void Simulation::check_convergence()
+{
+    if (!convergence)
+        return;
+    long long updates = m_strategy->rating_updates();
+    if (convergence->due(updates))
+        convergence->check(players, total_games_played, updates);
+}
+
 // Runs the simulation for `number` of games
 void Simulation::play_games(int number)
 {
@@ -86,25 +240,40 @@ void Simulation::play_games(int number)
 
     while (games_played < number)
     {
+        if (progress && progress->cancelled.load(std::memory_order_relaxed))
+            break;
+        if (convergence && convergence->converged())
+            break;
+
         // Pick a random player
         player = m_RNG() % players_num;
         if (games_played % 100 == 0)
             calculate_good_match_fraction(players[player], players_num);
 
+        // Only players from reachable regions with MMR close enough
+        if (candidate_index && candidate_index->find_candidates(players, player, m_strategy->mmr_window()) == 0)
+            continue;
+
         // Pick a random opponent
         for (int tries = 0; tries < 10000; tries++)
         {
-            opponent = m_RNG() % players_num;
+            if (candidate_index)
+                opponent = candidate_index->random_candidate(m_RNG);
+            else
+                opponent = m_RNG() % players_num;
             if (opponent == player) // we don't want the same player
                 continue;
             if (m_strategy->good_match(players[player], players[opponent]))
             {
                 resolve_game(players[player], players[opponent]);
+                m_strategy->game_finished(players);
+                check_convergence();
                 games_played++;
                 break;
             }
         }
     }
+    m_strategy->games_finished(players);
 }
 
 void Simulation::play_games(double number)
@@ -115,10 +284,94 @@ void Simulation::play_games(double number)
 void Simulation::calculate_good_match_fraction(Player &p, int players_num)
 {
     int good_matches = 0;
-    for (Player &player_iter : players)
+    if (m_good_match_sample > 0 && m_good_match_sample < players_num)
+    {
+        // Large populations: estimate from a random sample
+        for (int i = 0; i < m_good_match_sample; i++)
+        {
+            Player &player_iter = players[m_RNG() % players_num];
+            if (&player_iter != &p && m_strategy->good_match(p, player_iter))
+                good_matches++;
+        }
+        players_num = m_good_match_sample;
+    }
+    else
+        good_matches = static_cast<int>(m_strategy->count_good_matches(p, players));
+    double fraction = (double)good_matches / players_num;
+    if (aggregates)
+        aggregates->add_good_match_fraction(total_games_played, fraction);
+    if (progress)
+        progress->add_good_match_fraction(fraction);
+    if (m_record_raw)
+        good_match_fraction->push_back(fraction);
+}
+
+// Returns index of the player with `log_id`, adding a new player the first time the id is seen.
+// True skill of replayed players is unknown (NaN).
+int Simulation::replay_player(uint32_t log_id)
+{
+    int *index;
+    if (log_id < REPLAY_DENSE_IDS)
     {
-        if (&player_iter != &p && m_strategy->good_match(p, player_iter))
-            good_matches++;
+        if (log_id >= m_replay_dense.size())
+            m_replay_dense.resize(std::max<size_t>(log_id + 1, m_replay_dense.size() * 2), -1);
+        index = &m_replay_dense[log_id];
     }
-    good_match_fraction->push_back((double)good_matches / players_num);
+    else
+        index = &m_replay_sparse.emplace(log_id, -1).first->second;
+
+    if (*index >= 0)
+        return *index;
+
+    int id = static_cast<int>(skill_by_id.size());
+    double skill = std::numeric_limits<double>::quiet_NaN();
+    skill_by_id.push_back(skill);
+    log_ids.push_back(log_id);
+    // Skill percentiles are unknown, so the percentile policy tracks everyone
+    if (m_tracking == TrackingPolicy::none || m_tracking == TrackingPolicy::sample)
+        players.push_back(Player(skill, id));
+    else
+        players.push_back(Player(skill, id, m_history_encoding, m_strategy->uses_sigma(), m_track_every));
+    if (m_tracking == TrackingPolicy::sample)
+        apply_tracking_policy(id);
+    if (m_force_player_mmr > -1.0)
+        players.back().mmr = m_force_player_mmr;
+    if (m_force_player_sigma > -1.0)
+        players.back().sigma = m_force_player_sigma;
+    *index = id;
+    return id;
+}
+
+// Replays historical matches instead of simulated ones. Players are created as their ids appear in the log.
+// Actual winning chances are unknown, so prediction difference is measured against the result
+// (|1 - predicted chance of the winner|) and match accuracy is how far the prediction is from 50%.
+// Returns the number of replayed games.
+long long Simulation::replay(MatchLog &log)
+{
+    long long games = 0;
+    int64_t last_timestamp = std::numeric_limits<int64_t>::min();
+    log.for_each([&](uint32_t winner_id, uint32_t loser_id, int64_t timestamp)
+                 {
+                     if (progress && progress->cancelled.load(std::memory_order_relaxed))
+                         return false;
+                     if (winner_id == loser_id)
+                         return true;
+                     if (timestamp < last_timestamp)
+                         replay_out_of_order++;
+                     last_timestamp = timestamp;
+
+                     int winner = replay_player(winner_id);
+                     int loser = replay_player(loser_id);
+                     double pred_diff = m_strategy->update_mmr(players[winner], players[loser], 1.0);
+                     double match_acc = std::abs(0.5 - pred_diff);
+                     if (aggregates)
+                         aggregates->add_game(total_games_played, pred_diff, match_acc);
+                     record_metrics(pred_diff, match_acc);
+                     m_strategy->game_finished(players);
+                     check_convergence();
+                     games++;
+                     return true;
+                 });
+    m_strategy->games_finished(players);
+    return games;
 }
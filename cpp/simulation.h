@@ -2,29 +2,128 @@
 
 #include "player.h"
 #include "strategies.h"
+#include "aggregates.h"
+#include "progress.h"
+#include "latency.h"
+#include "candidate_index.h"
+#include "match_log.h"
+#include "memory.h"
+#include "convergence.h"
+#include "population.h"
 
 #include <chrono>
 #include <random>
 #include <memory>
+#include <unordered_map>
+#include <string>
+
+// Which players get their histories recorded
+enum class TrackingPolicy
+{
+    none,
+    all,
+    sample,    // random sample of `track_sample` players
+    percentile // players with skill percentile inside `track_percentile_min` - `track_percentile_max`
+};
+
+// Optional settings for a simulation run
+struct SimulationOptions
+{
+    // How player histories are stored
+    HistoryEncoding history_encoding = HistoryEncoding::full;
+    // Which players are tracked and how often
+    TrackingPolicy tracking = TrackingPolicy::all;
+    int track_sample = 0;
+    double track_percentile_min = 0;
+    double track_percentile_max = 100;
+    int track_every = 1;
+    // Whether to store raw per-game vectors (prediction_difference, match_accuracy, good_match_fraction)
+    bool record_raw = true;
+    // Number of game bins for aggregates computed during the run (0 → no aggregates)
+    int aggregate_bins = 0;
+    int percentile_groups = 10;
+    // Progress reporting and cancellation (optional)
+    std::shared_ptr<SimulationProgress> progress;
+    // Number of regions players are placed in (0 → no latency)
+    int regions = 0;
+    // Maximum latency for a good match in ms (0 → no limit)
+    double max_latency = 0;
+    // Search opponents through CandidateIndex instead of random tries
+    bool candidate_index = false;
+    // Estimate good_match_fraction from this many random players instead of the whole population (0 → all)
+    int good_match_sample = 0;
+    // Seed for the random engine (-1 → seed from the clock). Fixed seeds make runs reproducible.
+    long long seed = -1;
+    // Shared memory segment for live metrics (empty → none), snapshot every `metrics_every` games
+    std::string metrics_shm;
+    int metrics_every = 10000;
+    int metrics_capacity = 4096;
+    // Memory budget in bytes (0 → no limit). Over budget the recording is reduced (see `fit_memory_budget`)
+    // or, with `memory_refuse`, the simulation doesn't start.
+    long long memory_budget = 0;
+    bool memory_refuse = false;
+    // Stop playing games once the simulation converged (see `ConvergenceCriteria`)
+    ConvergenceCriteria convergence;
+    // Skills of new players
+    SkillDistribution skill_distribution;
+};
 
 class Simulation
 {
     std::default_random_engine m_RNG;
-    std::normal_distribution<> m_skill_distribution = std::normal_distribution<>(2820 / 2.2, 800 / 2.2);
     std::unique_ptr<MatchmakingStrategy> m_strategy;
+    // Players currently in the sampled subset (for TrackingPolicy::sample)
+    std::vector<int> m_sampled_ids;
+    // Player index by log id when replaying. Small ids are looked up directly, larger ones through the map.
+    static const uint32_t REPLAY_DENSE_IDS = 1 << 26;
+    std::vector<int> m_replay_dense;
+    std::unordered_map<uint32_t, int> m_replay_sparse;
+
+    int replay_player(uint32_t log_id);
+    void record_metrics(double pred_diff, double match_acc);
+    void check_convergence();
 
 public:
     std::vector<Player> players;
+    // Skills of all players ever added (indexed by player id). Used for decoding compact histories.
+    std::vector<double> skill_by_id;
     // The difference between actual winning chances and predicted winning chances
     std::unique_ptr<std::vector<double>> prediction_difference;
     // How far the chosen player winning chance is from 50%
     std::unique_ptr<std::vector<double>> match_accuracy;
     // The percent of players that are considered a good match for the first chosen player
     std::unique_ptr<std::vector<double>> good_match_fraction;
+    // Binned statistics (only if enabled)
+    std::unique_ptr<Aggregates> aggregates;
+    // Games played across all `play_games` calls
+    long long total_games_played = 0;
+    // Progress reporting and cancellation (only if set)
+    std::shared_ptr<SimulationProgress> progress;
+    // Player locations (only if set)
+    std::unique_ptr<LatencyModel> latency_model;
+    // Index used for finding opponents (only if set)
+    std::unique_ptr<CandidateIndex> candidate_index;
+    // Skills of new players
+    SkillDistribution skill_distribution;
+    // Ends `play_games` early once converged (only if set)
+    std::unique_ptr<ConvergenceCheck> convergence;
+    // Log id of each replayed player (indexed by player id)
+    std::vector<uint32_t> log_ids;
+    // Replayed matches with a timestamp older than the previous match
+    long long replay_out_of_order = 0;
     double m_force_player_mmr = -1.0;
     double m_force_player_sigma = -1.0;
+    HistoryEncoding m_history_encoding = HistoryEncoding::full;
+    TrackingPolicy m_tracking = TrackingPolicy::all;
+    int m_track_sample = 0;
+    double m_track_percentile_min = 0;
+    double m_track_percentile_max = 100;
+    int m_track_every = 1;
+    bool m_record_raw = true;
+    int m_good_match_sample = 0;
 
     Simulation(std::unique_ptr<MatchmakingStrategy> strat);
+    void seed(unsigned int value);
     void add_players(int number);
     void add_players(double number);
     void remove_players(int number);
@@ -33,4 +132,10 @@ public:
     void play_games(int number);
     void play_games(double number);
     void calculate_good_match_fraction(Player &p, int players_num);
+    void apply_tracking_policy(int first_new_player);
+    bool in_tracked_percentiles(double skill);
+    double skill_percentile(double skill);
+    long long replay(MatchLog &log);
+    std::array<double, MetricsRecord::MMR_QUANTILES> mmr_quantiles();
+    MemoryUsage memory_usage() const;
 };
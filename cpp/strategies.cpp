@@ -1,7 +1,9 @@
 #include "strategies.h"
+#include "population.h"
 
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 
 //
 // NAIVE MATCHMAKING STRATEGY
@@ -27,12 +29,16 @@ bool Naive_strategy::good_match(Player &p1, Player &p2)
     return std::abs(p1.mmr - p2.mmr) < offset * multiplier;
 }
 
+double Naive_strategy::mmr_window()
+{
+    return offset * multiplier;
+}
+
 double Naive_strategy::update_mmr(Player &winner, Player &loser, double actual_chances)
 {
-    winner.opponent_history->push_back(loser.skill);
-    winner.mmr_history->push_back(winner.mmr);
-    loser.opponent_history->push_back(winner.skill);
-    loser.mmr_history->push_back(loser.mmr);
+    // Naive strategy doesn't predict anything
+    winner.record_game(loser, 0.5);
+    loser.record_game(winner, 0.5);
 
     winner.mmr += offset;
     loser.mmr -= offset;
@@ -60,20 +66,20 @@ bool ELO_strategy::good_match(Player &p1, Player &p2)
     return std::abs(p1.mmr - p2.mmr) < 120.0; // 35 MMR → 55% ; 70 → 60% ; 120 → 66%; 191 → 75%
 }
 
+double ELO_strategy::mmr_window()
+{
+    return 120.0;
+}
+
 // Updates MMR for
 double ELO_strategy::update_mmr(Player &winner, Player &loser, double actual_chances)
 {
-    winner.opponent_history->push_back(loser.skill);
-    winner.mmr_history->push_back(winner.mmr);
-    loser.opponent_history->push_back(winner.skill);
-    loser.mmr_history->push_back(loser.mmr);
-
     // Chances of winning for the winner and loser. /400 is changed to 173. to use exp instead of pow(10,)
     double Ew = 1 / (1 + exp((loser.mmr - winner.mmr) / 173.718));
     double El = 1 - Ew;
 
-    winner.predicted_chances->push_back(Ew);
-    loser.predicted_chances->push_back(El);
+    winner.record_game(loser, Ew);
+    loser.record_game(winner, El);
 
     winner.mmr += K * El;
     loser.mmr -= K * El;
@@ -103,27 +109,27 @@ bool Tweaked_ELO_strategy::good_match(Player &p1, Player &p2)
     return std::abs(p1.mmr - p2.mmr) < 120.0; // 35 MMR → 55% ; 70 → 60% ; 120 → 66%; 191 → 75%
 }
 
+double Tweaked_ELO_strategy::mmr_window()
+{
+    return 120.0;
+}
+
 // Returns a learning coefficient for the player
 double Tweaked_ELO_strategy::get_learning_coefficient(Player &player, Player &other_player)
 {
-    double games = static_cast<double>(player.opponent_history->size()) - 1.0;
+    double games = static_cast<double>(player.games_played) - 1.0;
     return exp(-games / game_div);
 }
 
 // Updates MMR for
 double Tweaked_ELO_strategy::update_mmr(Player &winner, Player &loser, double actual_chances)
 {
-    winner.opponent_history->push_back(loser.skill);
-    winner.mmr_history->push_back(winner.mmr);
-    loser.opponent_history->push_back(winner.skill);
-    loser.mmr_history->push_back(loser.mmr);
-
     // Chances of winning for the winner and loser. /400 is changed to 173. to use exp instead of pow(10,)
     double Ew = 1 / (1 + exp((loser.mmr - winner.mmr) / 173.718));
     double El = 1 - Ew;
 
-    winner.predicted_chances->push_back(Ew);
-    loser.predicted_chances->push_back(El);
+    winner.record_game(loser, Ew);
+    loser.record_game(winner, El);
 
     // Simply update coeficient based on number of games
     // Fewer games → faster update
@@ -159,7 +165,233 @@ double Tweaked2_ELO_strategy::get_learning_coefficient(Player &player, Player &o
     // The idea here learning lowers as the player gets more games
     // And playing a new opponent will give you lower learning coefficient (wont lose too many points to him)
     // But a new player playing an old player gets high learning coefficient (still can gain a lot of points by playing someone solid)
-    int player_games = static_cast<int>(player.opponent_history->size()) - 1;
-    int other_player_games = static_cast<int>(other_player.opponent_history->size()) - 1;
+    int player_games = player.games_played - 1;
+    int other_player_games = other_player.games_played - 1;
     return std::min(exp((-coef * other_player_games - player_games) / game_div), 1.0);
 }
+
+//
+// LATENCY STRATEGY
+//
+
+Latency_strategy::Latency_strategy(std::unique_ptr<MatchmakingStrategy> inner, const LatencyModel *model, double pmax_latency)
+{
+    m_inner = std::move(inner);
+    m_model = model;
+    max_latency = pmax_latency;
+    std::cout << "with max latency " << max_latency << " ms\n";
+}
+
+double Latency_strategy::latency(Player &p1, Player &p2)
+{
+    return m_model->latency(p1.x, p1.y, p2.x, p2.y);
+}
+
+// Good match for the wrapped strategy and close enough
+bool Latency_strategy::good_match(Player &p1, Player &p2)
+{
+    return latency(p1, p2) <= max_latency && m_inner->good_match(p1, p2);
+}
+
+double Latency_strategy::update_mmr(Player &winner, Player &loser, double actual_chances)
+{
+    return m_inner->update_mmr(winner, loser, actual_chances);
+}
+
+bool Latency_strategy::uses_sigma()
+{
+    return m_inner->uses_sigma();
+}
+
+double Latency_strategy::mmr_window()
+{
+    return m_inner->mmr_window();
+}
+
+void Latency_strategy::game_finished(std::vector<Player> &players)
+{
+    m_inner->game_finished(players);
+}
+
+void Latency_strategy::games_finished(std::vector<Player> &players)
+{
+    m_inner->games_finished(players);
+}
+
+//
+// GLICKO-2 STRATEGY
+//
+
+// Glicko-2 helper functions (Glickman, "Example of the Glicko-2 system")
+static double glicko_g(double phi)
+{
+    const double pi = 3.14159265358979323846;
+    return 1 / sqrt(1 + 3 * phi * phi / (pi * pi));
+}
+
+static double glicko_E(double mu, double opponent_mu, double opponent_phi)
+{
+    return 1 / (1 + exp(-glicko_g(opponent_phi) * (mu - opponent_mu)));
+}
+
+Glicko2_strategy::Glicko2_strategy(int pperiod, double ptau)
+{
+    if (pperiod != -1)
+        period = pperiod;
+    if (ptau != -1)
+        tau = ptau;
+    std::cout << "GLICKO2 strategy (" << period << ", " << tau << ")\n";
+}
+
+bool Glicko2_strategy::good_match(Player &p1, Player &p2)
+{
+    return std::abs(p1.mmr - p2.mmr) < 120.0; // Same scale as ELO
+}
+
+double Glicko2_strategy::mmr_window()
+{
+    return 120.0;
+}
+
+// Ratings don't change until the end of the rating period, only results are saved
+double Glicko2_strategy::update_mmr(Player &winner, Player &loser, double actual_chances)
+{
+    double winner_mu = (winner.mmr - 1500) / SCALE;
+    double winner_phi = winner.sigma / SCALE;
+    double loser_mu = (loser.mmr - 1500) / SCALE;
+    double loser_phi = loser.sigma / SCALE;
+
+    // Predicted chance uses uncertainity of both players
+    double Ew = 1 / (1 + exp(-glicko_g(sqrt(winner_phi * winner_phi + loser_phi * loser_phi)) * (winner_mu - loser_mu)));
+    winner.record_game(loser, Ew);
+    loser.record_game(winner, 1 - Ew);
+
+    m_results.push_back({winner.id, loser_mu, loser_phi, 1.0});
+    m_results.push_back({loser.id, winner_mu, winner_phi, 0.0});
+    return std::abs(actual_chances - Ew);
+}
+
+void Glicko2_strategy::game_finished(std::vector<Player> &players)
+{
+    if (++m_games_in_period >= period)
+        end_period(players);
+}
+
+// Partial period at the end is processed too, so final ratings include all games
+void Glicko2_strategy::games_finished(std::vector<Player> &players)
+{
+    if (m_games_in_period > 0)
+        end_period(players);
+}
+
+void Glicko2_strategy::end_period(std::vector<Player> &players)
+{
+    // Group results by player id (counting sort)
+    int max_id = 0;
+    for (Player &p : players)
+        max_id = std::max(max_id, p.id);
+    if (static_cast<int>(m_volatility.size()) <= max_id)
+        m_volatility.resize(max_id + 1, START_VOLATILITY);
+
+    std::vector<int> offsets(max_id + 2, 0);
+    for (PeriodResult &r : m_results)
+        offsets[r.id + 1]++;
+    for (int i = 1; i < static_cast<int>(offsets.size()); i++)
+        offsets[i] += offsets[i - 1];
+    std::vector<PeriodResult> grouped(m_results.size());
+    std::vector<int> position(offsets.begin(), offsets.end() - 1);
+    for (PeriodResult &r : m_results)
+        grouped[position[r.id]++] = r;
+
+    // Update players in parallel chunks (populations of a single chunk stay on this thread).
+    // Each player only reads his own results and writes his own rating.
+    for_each_chunk(players.size(), [&](size_t chunk, size_t start, size_t end)
+                   {
+                       for (size_t i = start; i < end; i++)
+                       {
+                           int id = players[i].id;
+                           update_player(players[i], grouped.data() + offsets[id], offsets[id + 1] - offsets[id]);
+                       }
+                   });
+
+    m_results.clear();
+    m_games_in_period = 0;
+    m_periods++;
+}
+
+void Glicko2_strategy::update_player(Player &player, const PeriodResult *results, int count)
+{
+    double mu = (player.mmr - 1500) / SCALE;
+    double phi = player.sigma / SCALE;
+    double &sigma = m_volatility[player.id];
+
+    // Players that didn't play only get more uncertain, but never more than new players
+    if (count == 0)
+    {
+        player.sigma = std::min(sqrt(phi * phi + sigma * sigma), START_RD / SCALE) * SCALE;
+        return;
+    }
+
+    double v_inv = 0;
+    double delta_sum = 0;
+    for (int i = 0; i < count; i++)
+    {
+        double g = glicko_g(results[i].opponent_phi);
+        double E = glicko_E(mu, results[i].opponent_mu, results[i].opponent_phi);
+        v_inv += g * g * E * (1 - E);
+        delta_sum += g * (results[i].score - E);
+    }
+    double v = 1 / v_inv;
+    double delta = v * delta_sum;
+
+    sigma = new_volatility(phi, sigma, v, delta);
+    double phi_star = sqrt(phi * phi + sigma * sigma);
+    double new_phi = 1 / sqrt(1 / (phi_star * phi_star) + 1 / v);
+    double new_mu = mu + new_phi * new_phi * delta_sum;
+
+    player.mmr = new_mu * SCALE + 1500;
+    player.sigma = new_phi * SCALE;
+}
+
+// Iterative volatility solve (Illinois algorithm)
+double Glicko2_strategy::new_volatility(double phi, double sigma, double v, double delta)
+{
+    const double EPSILON = 0.000001;
+    double a = log(sigma * sigma);
+    auto f = [&](double x)
+    {
+        double ex = exp(x);
+        double d = phi * phi + v + ex;
+        return ex * (delta * delta - phi * phi - v - ex) / (2 * d * d) - (x - a) / (tau * tau);
+    };
+
+    double A = a;
+    double B;
+    if (delta * delta > phi * phi + v)
+        B = log(delta * delta - phi * phi - v);
+    else
+    {
+        int k = 1;
+        while (f(a - k * tau) < 0)
+            k++;
+        B = a - k * tau;
+    }
+
+    double fA = f(A);
+    double fB = f(B);
+    while (std::abs(B - A) > EPSILON)
+    {
+        double C = A + (A - B) * fA / (fB - fA);
+        double fC = f(C);
+        if (fC * fB <= 0)
+        {
+            A = B;
+            fA = fB;
+        }
+        else
+            fA = fA / 2;
+        B = C;
+        fB = fC;
+    }
+    return exp(A / 2);
+}
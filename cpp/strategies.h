@@ -2,7 +2,11 @@
 
 #include "player.h"
 #include "trueskill.h"
+#include "latency.h"
 #include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
 
 //
 // ABSTRACT CLASS FOR MATCHMAKING STRATEGY
@@ -12,6 +16,29 @@ class MatchmakingStrategy
 public:
     virtual bool good_match(Player &p1, Player &p2) = 0;
     virtual double update_mmr(Player &winner, Player &loser, double actual_chances) = 0;
+    // Whether the strategy uses player sigma (then it's saved into player histories as well)
+    virtual bool uses_sigma() { return false; }
+    // Largest MMR difference `good_match` can accept. Used to narrow the search for opponents.
+    virtual double mmr_window() { return std::numeric_limits<double>::infinity(); }
+    // Called after each game and after each batch of games (end of `play_games`).
+    // Strategies that don't update ratings immediately do their work here.
+    virtual void game_finished(std::vector<Player> &players){};
+    virtual void games_finished(std::vector<Player> &players){};
+    // Number of rating updates so far for strategies that update ratings in `game_finished` (-1 → every game).
+    // Convergence is only checked after ratings changed.
+    virtual long long rating_updates() { return -1; }
+    // Number of good matches for `player` among `players` (not counting himself)
+    virtual size_t count_good_matches(Player &player, std::vector<Player> &players)
+    {
+        size_t good = 0;
+        for (Player &other : players)
+            if (&other != &player && good_match(player, other))
+                good++;
+        return good;
+    }
+    // Starting MMR and sigma of new players (-1 → Player defaults)
+    virtual double initial_mmr() { return -1; }
+    virtual double initial_sigma() { return -1; }
 };
 
 //
@@ -27,6 +54,7 @@ public:
     Naive_strategy(double pK, double pMult);
     bool good_match(Player &p1, Player &p2);
     double update_mmr(Player &winner, Player &loser, double actual_chances);
+    double mmr_window() override;
 };
 
 //
@@ -41,6 +69,7 @@ public:
     ELO_strategy(double pK);
     bool good_match(Player &p1, Player &p2);
     double update_mmr(Player &winner, Player &loser, double actual_chances);
+    double mmr_window() override;
 };
 
 //
@@ -58,6 +87,7 @@ public:
     bool good_match(Player &p1, Player &p2);
     virtual double get_learning_coefficient(Player &player, Player &other_player);
     double update_mmr(Player &winner, Player &loser, double actual_chances);
+    double mmr_window() override;
 };
 
 //
@@ -78,6 +108,79 @@ public:
     double get_learning_coefficient(Player &player, Player &other_player) override;
 };
 
+//
+// LATENCY STRATEGY
+//
+
+// Wraps another strategy and additionally requires players to be within `max_latency` of each other
+class Latency_strategy : public MatchmakingStrategy
+{
+    std::unique_ptr<MatchmakingStrategy> m_inner;
+    const LatencyModel *m_model;
+
+public:
+    double max_latency;
+
+    Latency_strategy(std::unique_ptr<MatchmakingStrategy> inner, const LatencyModel *model, double pmax_latency);
+    double latency(Player &p1, Player &p2);
+    bool good_match(Player &p1, Player &p2);
+    double update_mmr(Player &winner, Player &loser, double actual_chances);
+    bool uses_sigma() override;
+    double mmr_window() override;
+    void game_finished(std::vector<Player> &players) override;
+    void games_finished(std::vector<Player> &players) override;
+    long long rating_updates() override { return m_inner->rating_updates(); }
+    double initial_mmr() override { return m_inner->initial_mmr(); }
+    double initial_sigma() override { return m_inner->initial_sigma(); }
+};
+
+//
+// GLICKO-2 STRATEGY
+//
+
+// Results are collected over a rating period (`period` games) and then all players are updated at once.
+// Player mmr is the Glicko rating, sigma is the rating deviation (RD). Volatility is kept here by player id.
+// Updates of different players are independent, so they are split between threads.
+class Glicko2_strategy : public MatchmakingStrategy
+{
+    // One game from the point of view of one player (Glicko-2 scale)
+    struct PeriodResult
+    {
+        int id;
+        double opponent_mu;
+        double opponent_phi;
+        double score;
+    };
+
+    std::vector<PeriodResult> m_results;
+    std::vector<double> m_volatility;
+    int m_games_in_period = 0;
+    long long m_periods = 0;
+
+    void update_player(Player &player, const PeriodResult *results, int count);
+    double new_volatility(double phi, double sigma, double v, double delta);
+
+public:
+    int period = 10000;
+    double tau = 0.5;
+    static constexpr double SCALE = 173.7178;
+    static constexpr double START_RD = 350;
+    static constexpr double START_VOLATILITY = 0.06;
+
+    Glicko2_strategy(int pperiod, double ptau);
+    bool good_match(Player &p1, Player &p2);
+    double update_mmr(Player &winner, Player &loser, double actual_chances);
+    bool uses_sigma() override { return true; }
+    double mmr_window() override;
+    // Players start with high rating deviation
+    double initial_sigma() override { return START_RD; }
+    void game_finished(std::vector<Player> &players) override;
+    void games_finished(std::vector<Player> &players) override;
+    long long rating_updates() override { return m_periods; }
+    // Updates all players with results from the current period
+    void end_period(std::vector<Player> &players);
+};
+
 //
 // TRUESKILL STRATEGY
 //
@@ -94,6 +197,11 @@ public:
         std::cout << "TRUESKILL strategy\n";
     }
 
+    bool uses_sigma() override { return true; }
+    // Trueskill uses its own rating scale
+    double initial_mmr() override { return MU; }
+    double initial_sigma() override { return SIGMA; }
+
     double match_quality(Player &p1, Player &p2)
     {
         /* Calculates relative probability of draw between to players relative to probability of a draw between
@@ -131,20 +239,13 @@ public:
 
     double update_mmr(Player &winner, Player &loser, double actual_chances)
     {
-        winner.opponent_history->push_back(loser.skill);
-        winner.mmr_history->push_back(winner.mmr);
-        loser.opponent_history->push_back(winner.skill);
-        loser.mmr_history->push_back(loser.mmr);
-        winner.sigma_history->push_back(winner.sigma);
-        loser.sigma_history->push_back(loser.sigma);
-
         // Update player skill and sigma
         match_pair old_pair{winner.mmr, winner.sigma, loser.mmr, loser.sigma};
         match_pair new_pair = trueskill_update(old_pair);
 
         double p1_winning_chance = winning_chance(winner, loser);
-        winner.predicted_chances->push_back(p1_winning_chance);
-        loser.predicted_chances->push_back(1 - p1_winning_chance);
+        winner.record_game(loser, p1_winning_chance);
+        loser.record_game(winner, 1 - p1_winning_chance);
         // if (p1_winning_chance > 0.9)
         //     print("winning chance:", p1_winning_chance, "match quality:", match_quality(winner, loser), winner.mmr, winner.sigma, loser.mmr, loser.sigma);
 
@@ -29,8 +29,10 @@ PyObject *set_trueskill_rate_1v1(PyObject *dummy, PyObject *args)
 }
 
 // Calls the Python function to update given pair according to the trueskill algorithm
+// Simulations can run without the GIL (or on their own thread), so it's acquired here.
 match_pair trueskill_update(match_pair pair)
 {
+    PyGILState_STATE gstate = PyGILState_Ensure();
     PyObject *arglist = Py_BuildValue("(ddddi)", pair.winner_mu, pair.winner_sigma, pair.loser_mu, pair.loser_sigma, pair.draw);
     PyObject *result = PyObject_CallObject(trueskill_rate_1v1, arglist);
     Py_DECREF(arglist);
@@ -40,5 +42,6 @@ match_pair trueskill_update(match_pair pair)
     if (result == NULL)
         print("ERROR: Failed to parse tuple");
     Py_DecRef(result);
+    PyGILState_Release(gstate);
     return new_data;
 }
\ No newline at end of file
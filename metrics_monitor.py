@@ -0,0 +1,110 @@
+"""
+Watches live metrics of a simulation running in another process.
+
+Start the simulation with a shared memory name:
+
+    psimulation.run_simulation_aggregated(1_000_000, 500_000_000, "tweaked2_elo", metrics_shm="psim_metrics")
+
+and run the monitor with the same name:
+
+    python metrics_monitor.py psim_metrics
+
+Reading never blocks the simulation. If the monitor falls behind by more than the ring capacity,
+old snapshots are skipped.
+
+"""
+import argparse
+import time
+from multiprocessing import resource_tracker, shared_memory
+
+import numpy as np
+
+MAGIC = 0x4d495350
+VERSION = 1
+MMR_QUANTILES = 11
+
+HEADER = np.dtype([("magic", "<u4"), ("version", "<u4"), ("capacity", "<u4"), ("record_size", "<u4"),
+                   ("written", "<u8"), ("finished", "<u4"), ("padding", "<u4")])
+RECORD = np.dtype([("sequence", "<u8"), ("games_played", "<i8"), ("games_per_second", "<f8"),
+                   ("prediction_difference", "<f8"), ("match_accuracy", "<f8"), ("good_match_fraction", "<f8"),
+                   ("mmr_quantiles", "<f8", (MMR_QUANTILES, ))])
+
+
+class MetricsReader:
+    """ Reads records from the shared memory ring written by the simulation """
+
+    def __init__(self, name, timeout=30):
+        start = time.time()
+        while True:
+            try:
+                self.shm = shared_memory.SharedMemory(name=name)
+                break
+            except FileNotFoundError:
+                if time.time() - start > timeout:
+                    raise
+                time.sleep(0.2)
+        # The simulation owns the segment, don't let the resource tracker remove it when we exit
+        try:
+            resource_tracker.unregister(self.shm._name, "shared_memory")
+        except Exception:
+            pass
+
+        self.header = np.ndarray((1, ), HEADER, self.shm.buf)
+        while self.header["magic"][0] != MAGIC:
+            time.sleep(0.01)
+        if self.header["version"][0] != VERSION or self.header["record_size"][0] != RECORD.itemsize:
+            raise RuntimeError("Unsupported metrics ring layout")
+        self.capacity = int(self.header["capacity"][0])
+        self.records = np.ndarray((self.capacity, ), RECORD, self.shm.buf, offset=HEADER.itemsize)
+        self.next = 0
+
+    @property
+    def finished(self):
+        return bool(self.header["finished"][0])
+
+    def read(self):
+        """ Returns records written since the last call (structured numpy array) """
+        written = int(self.header["written"][0])
+        first = max(self.next, written - self.capacity)
+        result = []
+        for n in range(first, written):
+            slot = self.records[n % self.capacity]
+            if slot["sequence"] != n + 1:
+                continue
+            record = slot.copy()
+            # Overwritten while copying
+            if slot["sequence"] != n + 1:
+                continue
+            result.append(record)
+        self.next = written
+        return np.array(result, dtype=RECORD)
+
+    def close(self):
+        del self.header, self.records
+        self.shm.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("name", help="shared memory name passed as metrics_shm")
+    parser.add_argument("--interval", type=float, default=1, help="seconds between reads")
+    args = parser.parse_args()
+
+    reader = MetricsReader(args.name)
+    print(f"{'games':>14} {'games/s':>12} {'pred diff':>10} {'match acc':>10} {'good match':>11}   MMR 10% / 50% / 90%")
+    while True:
+        finished = reader.finished
+        records = reader.read()
+        if len(records):
+            r = records[-1]
+            q = r["mmr_quantiles"]
+            print(f"{r['games_played']:>14,} {r['games_per_second']:>12,.0f} {r['prediction_difference']:>10.4f} "
+                  f"{r['match_accuracy']:>10.4f} {r['good_match_fraction']:>11.4f}   {q[1]:.0f} / {q[5]:.0f} / {q[9]:.0f}")
+        if finished:
+            break
+        time.sleep(args.interval)
+    reader.close()
+
+
+if __name__ == "__main__":
+    main()
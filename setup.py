@@ -1,6 +1,16 @@
+import os
+import sys
 from distutils.core import setup, Extension
 import numpy
 
+# PSIM_FLOAT_RATINGS=1 stores player ratings as float32 (for very large populations)
+define_macros = []
+if os.environ.get("PSIM_FLOAT_RATINGS"):
+    define_macros.append(("PSIM_FLOAT_RATINGS", None))
+
+# Shared memory (shm_open) and strategy plugins (dlopen) need librt and libdl on older glibc
+libraries = ["rt", "dl"] if sys.platform.startswith("linux") else []
+
 setup(
     name='psimulation',
     version='1.0',
@@ -9,9 +19,15 @@ setup(
             "psimulation",
             [
                 "cpp/sim.cpp", "cpp/strategies.cpp", "cpp/simulation.cpp",
-                "cpp/main.cpp", "cpp/trueskill.cpp"
+                "cpp/main.cpp", "cpp/trueskill.cpp", "cpp/aggregates.cpp",
+                "cpp/candidate_index.cpp", "cpp/match_log.cpp",
+                "cpp/metrics_ring.cpp", "cpp/memory.cpp", "cpp/plugins.cpp",
+                "cpp/python_strategy.cpp", "cpp/convergence.cpp",
+                "cpp/population.cpp"
             ],
             include_dirs=[numpy.get_include()],
+            define_macros=define_macros,
+            libraries=libraries,
         )
     ],
 )
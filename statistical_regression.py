@@ -0,0 +1,188 @@
+"""
+Checks that the simulation engine still produces the same distributions.
+
+Runs every strategy at fixed seeds and compares MMR-skill correlation, prediction differences,
+match accuracy and good match fraction against stored reference distributions.
+Also checks that compact histories decode to the full ones.
+Run it before and after changing the engine (RNG, play_games, strategies, fast paths).
+
+    python statistical_regression.py            # compare against the reference
+    python statistical_regression.py --update   # store a new reference
+    python statistical_regression.py --seeds 11 12 13 --option candidate_index=True
+
+Exits with non-zero status if any check fails.
+
+"""
+import argparse
+import ast
+import json
+import sys
+
+import numpy as np
+
+import psimulation
+
+REFERENCE = "statistical_reference.json"
+PLAYERS = 5000
+GAMES = 500000
+SEEDS = (1, 2, 3)
+# Trueskill needs the python callback and is too slow for a quick check
+STRATEGIES = ("naive", "elo", "tweaked_elo", "tweaked2_elo", "glicko2")
+QUANTILES = np.linspace(0, 1, 101)
+
+# Tolerances. Different seeds of an unchanged engine stay well inside these.
+# Good match fraction is measured only every 100 games and changes slowly, so its sample is small and correlated
+MAX_KS_DISTANCE = {"prediction_difference": 0.02, "match_accuracy": 0.02, "good_match_fraction": 0.1}
+MAX_CORRELATION_DIFFERENCE = 0.01
+MAX_MEAN_DIFFERENCE = 0.03  # relative
+# Largest decoding error of compact histories (one fixed-point step)
+COMPACT_TOLERANCE = {"mmr_history": 1 / 128, "sigma_history": 1 / 2048, "predicted_chances": 1 / 65535,
+                     "opponent_history": 1e-3}
+
+
+def run_strategy(strategy, seeds, options):
+    """ Runs strategy for each seed and returns pooled statistics """
+    correlations = []
+    prediction_difference = []
+    match_accuracy = []
+    good_match_fraction = []
+    for seed in seeds:
+        players, pred, acc, fraction = psimulation.run_simulation(
+            PLAYERS, GAMES, strategy, tracking="none", seed=seed, **options)
+        skill = np.array([p["skill"] for p in players])
+        mmr = np.array([p["mmr"] for p in players])
+        correlations.append(np.corrcoef(skill, mmr)[0, 1])
+        prediction_difference.append(np.array(pred))
+        match_accuracy.append(np.array(acc))
+        good_match_fraction.append(np.array(fraction))
+
+    return {
+        "mmr_skill_correlation": float(np.mean(correlations)),
+        "prediction_difference": np.concatenate(prediction_difference),
+        "match_accuracy": np.concatenate(match_accuracy),
+        "good_match_fraction": np.concatenate(good_match_fraction),
+    }
+
+
+def describe(values):
+    """ Reduces a sample to what is stored in the reference """
+    return {
+        "mean": float(np.mean(values)),
+        "quantiles": [float(f"{q:.6g}") for q in np.quantile(values, QUANTILES)]
+    }
+
+
+def ks_distance(values, quantiles):
+    """
+    Kolmogorov-Smirnov distance between a sample and a distribution given by its quantiles.
+    Quantiles can repeat (discrete values), so the sample CDF only has to reach the quantile level
+    somewhere within the jump at that value.
+
+    """
+    values = np.sort(values)
+    quantiles = np.array(quantiles)
+    below = np.searchsorted(values, quantiles, side="left") / len(values)
+    upto = np.searchsorted(values, quantiles, side="right") / len(values)
+    distance = np.where(QUANTILES < below, below - QUANTILES, 0)
+    distance = np.maximum(distance, np.where(QUANTILES > upto, QUANTILES - upto, 0))
+    return float(np.max(distance))
+
+
+def compare(strategy, stats, reference):
+    """ Compares statistics to the reference. Returns list of failed checks. """
+    failed = []
+
+    difference = abs(stats["mmr_skill_correlation"] - reference["mmr_skill_correlation"])
+    print(f"  mmr_skill_correlation {stats['mmr_skill_correlation']:.4f} "
+          f"(reference {reference['mmr_skill_correlation']:.4f})")
+    if difference > MAX_CORRELATION_DIFFERENCE:
+        failed.append(f"{strategy}: mmr_skill_correlation differs by {difference:.4f}")
+
+    for name in ("prediction_difference", "match_accuracy", "good_match_fraction"):
+        mean = float(np.mean(stats[name]))
+        ref_mean = reference[name]["mean"]
+        relative = abs(mean - ref_mean) / max(abs(ref_mean), 1e-9)
+        distance = ks_distance(stats[name], reference[name]["quantiles"])
+        print(f"  {name} mean {mean:.4f} (reference {ref_mean:.4f}), KS distance {distance:.4f}")
+        if relative > MAX_MEAN_DIFFERENCE:
+            failed.append(f"{strategy}: {name} mean differs by {relative:.1%}")
+        if distance > MAX_KS_DISTANCE[name]:
+            failed.append(f"{strategy}: {name} KS distance {distance:.4f}")
+
+    return failed
+
+
+def check_compact_history(seed):
+    """
+    Runs Glicko-2 (large rating jumps at the end of each period) with full and compact histories.
+    Returns list of failed checks.
+
+    """
+    failed = []
+    full, compact = (psimulation.run_simulation(2000, 200000, "glicko2", seed=seed, compact_history=encoding)[0]
+                     for encoding in (False, True))
+    for name, tolerance in COMPACT_TOLERANCE.items():
+        error = max(float(np.max(np.abs(f[name] - c[name]), initial=0)) for f, c in zip(full, compact))
+        print(f"  {name} largest error {error:.3g}")
+        if not error <= tolerance:
+            failed.append(f"compact history: {name} differs by {error:.3g}")
+    return failed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--update", action="store_true", help="store new reference distributions")
+    parser.add_argument("--seeds", type=int, nargs="+", default=SEEDS)
+    parser.add_argument("--strategies", nargs="+", default=STRATEGIES)
+    parser.add_argument("--option", action="append", default=[],
+                        help="extra simulation keyword option, e.g. candidate_index=True")
+    args = parser.parse_args()
+
+    options = dict()
+    for option in args.option:
+        key, value = option.split("=", 1)
+        options[key] = ast.literal_eval(value)
+
+    reference = dict()
+    if not args.update:
+        with open(REFERENCE, "r") as f:
+            reference = json.load(f)
+
+    failed = []
+    for strategy in args.strategies:
+        print(f"{strategy}:")
+        stats = run_strategy(strategy, args.seeds, options)
+        if args.update:
+            reference[strategy] = {
+                "mmr_skill_correlation": stats["mmr_skill_correlation"],
+                "prediction_difference": describe(stats["prediction_difference"]),
+                "match_accuracy": describe(stats["match_accuracy"]),
+                "good_match_fraction": describe(stats["good_match_fraction"]),
+            }
+        elif strategy not in reference:
+            failed.append(f"{strategy}: no reference (run with --update)")
+        else:
+            failed.extend(compare(strategy, stats, reference[strategy]))
+
+    if not args.update:
+        print("compact history:")
+        failed.extend(check_compact_history(args.seeds[0]))
+
+    if args.update:
+        reference["settings"] = {"players": PLAYERS, "games": GAMES, "seeds": list(args.seeds)}
+        with open(REFERENCE, "w") as f:
+            json.dump(reference, f, indent=1)
+        print(f"Reference saved to {REFERENCE}")
+        return 0
+
+    if failed:
+        print("\nFAILED:")
+        for fail in failed:
+            print(f"  {fail}")
+        return 1
+    print("\nAll distributions match the reference")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,9 +1,17 @@
 import traceback
 from functools import lru_cache
+from statistics import NormalDist
 from typing import Tuple
 
+import numpy as np
 import trueskill
 
+# trueskill package defaults
+BETA = 25 / 6
+TAU = 25 / 300
+DRAW_PROBABILITY = 0.1
+DRAW_MARGIN = NormalDist().inv_cdf((DRAW_PROBABILITY + 1) / 2) * np.sqrt(2) * BETA
+
 
 class Stats:
     min_mu = 0
@@ -36,3 +44,49 @@ def rate_1v1(winner_mu: float,
         traceback.print_exc()
         return (winner_mu, winner_sigma, loser_mu, loser_sigma)
     return (winner.mu, winner.sigma, loser.mu, loser.sigma)
+
+
+def _norm_cdf(x: np.ndarray) -> np.ndarray:
+    """ Normal CDF with the complementary error function approximation used by trueskill (error < 1.2e-7) """
+    z = np.abs(x / np.sqrt(2))
+    t = 1 / (1 + z / 2)
+    r = t * np.exp(-z * z - 1.26551223 + t *
+                   (1.00002368 + t *
+                    (.37409196 + t *
+                     (.09678418 + t *
+                      (-.18628806 + t *
+                       (.27886807 + t *
+                        (-1.13520398 + t * (1.48851587 + t * (-.82215223 + t * .17087277)))))))))
+    erfc = np.where(x >= 0, r, 2 - r)
+    return 1 - erfc / 2
+
+
+def rate_1v1_batch(winner_mu: np.ndarray, winner_sigma: np.ndarray, loser_mu: np.ndarray,
+                   loser_sigma: np.ndarray) -> Tuple[np.ndarray, np.ndarray, np.ndarray, np.ndarray]:
+    """
+    Vectorized `rate_1v1` (without draws) for the "python_batch" strategy.
+    Takes arrays with one game per element and returns updated arrays in the same order.
+
+        psimulation.set_batch_strategy(trueskill_rate.rate_1v1_batch)
+        psimulation.run_simulation(20000, 2000000, "python_batch")
+
+    """
+    winner_var = winner_sigma**2 + TAU**2
+    loser_var = loser_sigma**2 + TAU**2
+    c = np.sqrt(2 * BETA**2 + winner_var + loser_var)
+
+    x = (winner_mu - loser_mu) / c - DRAW_MARGIN / c
+    cdf = _norm_cdf(x)
+    pdf = np.exp(-x * x / 2) / np.sqrt(2 * np.pi)
+    with np.errstate(divide="ignore", invalid="ignore"):
+        v = np.where(cdf > 0, pdf / cdf, -x)
+    w = v * (v + x)
+
+    new_winner_mu = winner_mu + winner_var / c * v
+    new_loser_mu = loser_mu - loser_var / c * v
+    new_winner_sigma = np.sqrt(winner_var * (1 - winner_var / c**2 * w))
+    new_loser_sigma = np.sqrt(loser_var * (1 - loser_var / c**2 * w))
+
+    Stats.max_mu = max(Stats.max_mu, float(new_winner_mu.max()))
+    Stats.min_mu = min(Stats.min_mu, float(new_loser_mu.min()))
+    return new_winner_mu, new_winner_sigma, new_loser_mu, new_loser_sigma